@@ -3,6 +3,8 @@ import os
 import sys
 import re
 import glob
+import struct
+import zlib
 
 
 class DataReader:
@@ -119,6 +121,113 @@ class File:
         return dt*np.arange(0, self.xlength, 1)
 
 
+class ChunkedFile:
+    """ Reads the columns of a data.fchk file, written by the simulation
+    when outputFormat is chunked.
+
+    The layout is described in simulate/src/DataOutput/chunkedfile.h,
+    and the compression of the chunks in compressor.h. Only the chunks
+    holding the requested records are read and decoded.
+
+    Attributes:
+        path: Path to the file.
+        columns: A dict mapping column names, such as 'beamShearForce',
+            to a dict with the period, count, numRecords, chunkLength,
+            firstTimestep and the chunk offsets and sizes of the column.
+        compression: The name of the compression of the chunks.
+        tolerance: The tolerance of the quantize compression.
+    """
+    header = struct.Struct('<4sIIIQIId')
+    column = struct.Struct('<IIQQQq32s')
+    compressions = ['none', 'shuffle', 'xor', 'quantize']
+
+    def __init__(self, path):
+        self.path = path
+        self.columns = {}
+        with open(path, 'rb') as infile:
+            magic, version, numColumns, chunkSize, indexOffset, \
+                compression, _, self.tolerance = \
+                self.header.unpack(infile.read(self.header.size))
+            if magic != b'FCHK' or version != 2:
+                raise RuntimeError("{} is not a chunked file".format(path))
+            if indexOffset == 0:
+                raise RuntimeError("{} was not closed".format(path))
+            self.compression = self.compressions[compression]
+            order = []
+            for _ in range(numColumns):
+                id, period, count, numRecords, chunkLength, first, name = \
+                    self.column.unpack(infile.read(self.column.size))
+                name = name.rstrip(b'\0').decode()
+                order.append(name)
+                self.columns[name] = {'id': id, 'period': period,
+                                      'count': count,
+                                      'numRecords': numRecords,
+                                      'chunkLength': chunkLength,
+                                      'firstTimestep': first}
+            infile.seek(indexOffset)
+            for name in order:
+                numChunks, = struct.unpack('<Q', infile.read(8))
+                index = np.fromfile(infile, dtype='<i8', count=3*numChunks)
+                self.columns[name]['offsets'] = index[1::3]
+                self.columns[name]['sizes'] = index[2::3]
+
+    def timesteps(self, name):
+        """ The timesteps of the records of a column. """
+        column = self.columns[name]
+        return (column['firstTimestep'] +
+                column['period']*np.arange(column['numRecords']))
+
+    def read(self, name, start=None, stop=None):
+        """ Reads the records of a column with start <= timestep < stop.
+
+        Returns:
+            An array of shape (records, count).
+        """
+        column = self.columns[name]
+        period, count = column['period'], column['count']
+        first, length = column['firstTimestep'], column['chunkLength']
+        begin = 0 if start is None else -(-(start-first)//period)
+        end = column['numRecords'] if stop is None \
+            else -(-(stop-first)//period)
+        begin = max(begin, 0)
+        end = min(end, column['numRecords'])
+
+        data = np.empty((max(end-begin, 0), count))
+        with open(self.path, 'rb') as infile:
+            record = begin
+            while record < end:
+                chunk, inChunk = divmod(record, length)
+                num = min(length-inChunk, end-record)
+                if self.compression == 'none':
+                    infile.seek(int(column['offsets'][chunk]) +
+                                8*count*inChunk)
+                    records = np.fromfile(infile, count=num*count)
+                    records = records.reshape(num, count)
+                else:
+                    infile.seek(int(column['offsets'][chunk]))
+                    encoded = infile.read(int(column['sizes'][chunk]))
+                    records = self.decode(encoded, count)
+                    records = records[inChunk:inChunk+num]
+                data[record-begin:record-begin+num] = records
+                record += num
+        return data
+
+    def decode(self, encoded, count):
+        """ Decodes a compressed chunk into an array of its records. """
+        planes = np.frombuffer(zlib.decompress(encoded), dtype=np.uint8)
+        words = np.ascontiguousarray(planes.reshape(8, -1).T).view('<u8')
+        words = words.reshape(-1, count)
+        if self.compression == 'shuffle':
+            return words.view('<f8')
+        elif self.compression == 'xor':
+            return np.bitwise_xor.accumulate(words, axis=0).view('<f8')
+        elif self.compression == 'quantize':
+            zigzag = (words >> np.uint64(1)).astype(np.int64) ^ \
+                -(words & np.uint64(1)).astype(np.int64)
+            return np.cumsum(zigzag, axis=0)*self.tolerance
+        raise RuntimeError("Unknown compression {}".format(self.compression))
+
+
 class Parser:
     @staticmethod
     def parse(path, delimiter=r'\s+', comment='#'):
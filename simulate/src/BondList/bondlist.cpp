@@ -0,0 +1,576 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "bondlist.h"
+#include "Node/node.h"
+#include "NodeInfo/nodeinfo.h"
+#include "LatticeInfo/latticeinfo.h"
+#include "NodeStore/placement.h"
+#include "ForceModifier/ModifierBatch/modifierbatch.h"
+
+#define pi 3.14159265358979323
+
+namespace {
+// The SIMD kernel is compiled for each of these instruction sets, and the
+// best one the machine supports is picked when the program is loaded
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define SIMD_TARGETS __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define SIMD_TARGETS
+#endif
+
+// atan2 without branches, so that it can be evaluated in vector lanes.
+// The argument is reduced to [0, tan(pi/8)] and the arctangent found by the
+// rational approximation of Cephes, accurate to about one ulp. The result is
+// in [-pi, pi], with atan2(-0, x) = 0 rather than -0
+inline double atan2Branchless(double y, double x)
+{
+    const double ax = std::fabs(x);
+    const double ay = std::fabs(y);
+    const bool   swap = ay > ax;
+    const double num = swap ? ax : ay;
+    const double den = swap ? ay : ax;
+    // Above tan(pi/8) the argument is reduced by atan(t) = pi/4 + atan((t-1)/(t+1)),
+    // which is folded into the one division
+    const bool   shift = num > 0.41421356237309504880*den;
+    const double n = shift ? num - den : num;
+    const double m = shift ? num + den : den;
+    const double t = m > 0 ? n/m : 0;
+    const double z = t*t;
+    const double p = (((-8.750608600031904122785e-1*z - 1.615753718733365076637e1)*z
+                       - 7.500855792314704667340e1)*z - 1.228866684490136173410e2)*z
+                       - 6.485021904942025371773e1;
+    const double q = ((((z + 2.485846490142306297962e1)*z + 1.650270098316988542046e2)*z
+                       + 4.328810604912902668951e2)*z + 4.853903996359136964868e2)*z
+                       + 1.945506571482613964425e2;
+    double angle = t + t*z*p/q;
+    angle = shift ? angle + pi/4 : angle;
+
+    angle = swap  ? pi/2 - angle : angle;
+    angle = x < 0 ? pi - angle : angle;
+    return y < 0 ? -angle : angle;
+}
+
+// The angle from the current direction (rx, ry) of a beam of the given length
+// to its rest direction, a unit vector, from the cross and dot products alone.
+// With h = tan(theta/2) = cross/(length + dot) the angle is 2 atan(h), whose
+// series is cut after h^9. The error is below 1e-15 for rotations up to
+// 0.1 rad and 2e-10 at 0.3 rad, and grows quickly beyond that
+inline double smallAngleRotation(double rx, double ry, double restX, double restY, double length)
+{
+    const double h  = (rx*restY - ry*restX)/(length + rx*restX + ry*restY);
+    const double h2 = h*h;
+    return 2*h*(1 - h2*(1.0/3 - h2*(1.0/5 - h2*(1.0/7 - h2*(1.0/9)))));
+}
+
+// The force and moment on the owner of each bond in [begin, end), written to
+// fx, fy and moment from index 0
+template <bool smallAngle>
+SIMD_TARGETS
+void beamKernel(const double *x, const double *y, const double *phi,
+                const size_t *owner, const size_t *neighbor, const double *d0,
+                const double *restX, const double *restY, size_t begin, size_t end,
+                double kappa_n, double kappa_s, double Phi,
+                double *fx, double *fy, double *moment)
+{
+#pragma omp simd
+    for (size_t b = begin; b < end; b++){
+        const size_t i = owner[b];
+        const size_t j = neighbor[b];
+        const double rx = x[j] - x[i];
+        const double ry = y[j] - y[i];
+        const double dij = sqrt(rx*rx + ry*ry);
+        const double invDij = 1.0/dij;
+
+        // The angle from the current to the rest direction of the beam,
+        // which is phiOffset - atan2(ry, rx) already wrapped to [-pi, pi]
+        const double phiCorrection = smallAngle
+            ? smallAngleRotation(rx, ry, restX[b], restY[b], dij)
+            : atan2Branchless(rx*restY[b] - ry*restX[b], rx*restX[b] + ry*restY[b]);
+
+        const double phi_ij = phi[i] + phiCorrection;
+        const double phi_ji = phi[j] + phiCorrection;
+
+        const double fn = kappa_n*(dij-d0[b]);
+        const double fs = -kappa_s*0.5*(phi_ij + phi_ji);
+        const double m  = -kappa_s*dij*(Phi/12.0*(phi_ij-phi_ji)+0.5*(2.0/3.0*phi_ij+1.0/3.0*phi_ji));
+
+        moment[b-begin] = m;
+        fx[b-begin]     = (rx*fn - ry*fs)*invDij;
+        fy[b-begin]     = (ry*fn + rx*fs)*invDij;
+    }
+}
+}
+
+BondList::BondList()
+{
+
+}
+
+void BondList::build(const std::vector<std::shared_ptr<Node>> &nodes, size_t numNodes)
+{
+    // Count the bonds of each node
+    std::vector<const Node*> byIndex(numNodes, nullptr);
+    for (auto & node : nodes){
+        if (node->index() >= numNodes)
+            throw std::runtime_error("Node is not part of the lattice store");
+        byIndex[node->index()] = node.get();
+    }
+
+    offsets.assign(numNodes+1, 0);
+    for (size_t i = 0; i < numNodes; i++)
+        offsets[i+1] = offsets[i] + (byIndex[i] ? byIndex[i]->getNeighborInfo().size() : 0);
+
+    neighbor.resize(offsets[numNodes]);
+    d0.resize(offsets[numNodes]);
+    phiOffset.resize(offsets[numNodes]);
+    restX.resize(offsets[numNodes]);
+    restY.resize(offsets[numNodes]);
+    for (size_t i = 0; i < numNodes; i++){
+        if (!byIndex[i])
+            continue;
+        size_t b = offsets[i];
+        for (auto & info : byIndex[i]->getNeighborInfo()){
+            neighbor[b]  = info->node()->index();
+            d0[b]        = info->d0();
+            phiOffset[b] = info->phiOffset();
+            restX[b]     = cos(phiOffset[b]);
+            restY[b]     = sin(phiOffset[b]);
+            b++;
+        }
+    }
+}
+
+void BondList::setKernel(Kernel kernel)
+{
+    m_kernel = kernel;
+    if (m_kernel == Kernel::HALF)
+        buildPairs();
+    else if (m_kernel == Kernel::SIMD)
+        buildSimd();
+}
+
+void BondList::place(Placement placement)
+{
+    placement::place(neighbor, placement, &offsets);
+    placement::place(d0, placement, &offsets);
+    placement::place(phiOffset, placement, &offsets);
+    placement::place(owner, placement, &offsets);
+    placement::place(restX, placement, &offsets);
+    placement::place(restY, placement, &offsets);
+    placement::place(offsets, placement);
+
+    placement::placeSegments(pairFirst, placement, colorOffsets);
+    placement::placeSegments(pairSecond, placement, colorOffsets);
+    placement::placeSegments(pairD0, placement, colorOffsets);
+    placement::placeSegments(pairPhiOffset, placement, colorOffsets);
+    placement::placeSegments(pairRestX, placement, colorOffsets);
+    placement::placeSegments(pairRestY, placement, colorOffsets);
+}
+
+void BondList::buildPairs()
+{
+    /* Greedy edge coloring of the beams. Each beam (i, j), i < j, is given the
+       lowest color not yet used by either i or j. The triangular lattice has at
+       most six beams per node, so at most eleven colors are needed.
+    */
+    const size_t numNodes = offsets.size()-1;
+    std::vector<unsigned long long> usedColors(numNodes, 0);
+    std::vector<std::vector<size_t>> colors;
+    for (size_t i = 0; i < numNodes; i++){
+        for (size_t b = offsets[i]; b < offsets[i+1]; b++){
+            const size_t j = neighbor[b];
+            if (j <= i)
+                continue;
+            const unsigned long long used = usedColors[i] | usedColors[j];
+            size_t color = 0;
+            while (color < 64 && (used >> color) & 1ULL)
+                color++;
+            if (color == 64)
+                throw std::runtime_error("Too many beams per node to color the bond list");
+            usedColors[i] |= 1ULL << color;
+            usedColors[j] |= 1ULL << color;
+            if (color >= colors.size())
+                colors.resize(color+1);
+            colors[color].push_back(b);
+        }
+    }
+
+    colorOffsets.assign(colors.size()+1, 0);
+    for (size_t c = 0; c < colors.size(); c++)
+        colorOffsets[c+1] = colorOffsets[c] + colors[c].size();
+    const size_t numPairs = colorOffsets[colors.size()];
+    pairFirst.resize(numPairs);
+    pairSecond.resize(numPairs);
+    pairD0.resize(numPairs);
+    pairPhiOffset.resize(numPairs);
+    pairRestX.resize(numPairs);
+    pairRestY.resize(numPairs);
+
+    size_t p = 0;
+    for (auto & color : colors){
+        for (size_t b : color){
+            // Find the node owning the bond
+            size_t i = static_cast<size_t>(std::upper_bound(offsets.begin(), offsets.end(), b) - offsets.begin()) - 1;
+            pairFirst[p]     = i;
+            pairSecond[p]    = neighbor[b];
+            pairD0[p]        = d0[b];
+            pairPhiOffset[p] = phiOffset[b];
+            pairRestX[p]     = restX[b];
+            pairRestY[p]     = restY[b];
+            p++;
+        }
+    }
+}
+
+void BondList::buildSimd()
+{
+    const size_t numNodes = offsets.size()-1;
+    owner.resize(numBonds());
+    for (size_t i = 0; i < numNodes; i++)
+        for (size_t b = offsets[i]; b < offsets[i+1]; b++)
+            owner[b] = i;
+}
+
+void BondList::setDamping(size_t i, double eta)
+{
+    if (damping.empty())
+        damping.assign(offsets.size()-1, 0.0);
+    damping[i] = eta;
+}
+
+double BondList::rotationError(const NodeStore &s) const
+{
+    double error = 0;
+    for (size_t i = 0; i+1 < offsets.size(); i++){
+        for (size_t b = offsets[i]; b < offsets[i+1]; b++){
+            const size_t j = neighbor[b];
+            const double rx = s.x[j] - s.x[i];
+            const double ry = s.y[j] - s.y[i];
+            double exact = phiOffset[b] - atan2(ry, rx);
+            if (exact > pi)
+                exact -= 2*pi;
+            else if (exact <= -pi)
+                exact += 2*pi;
+            const double approximate = smallAngleRotation(rx, ry, restX[b], restY[b], sqrt(rx*rx + ry*ry));
+            error = std::max(error, std::fabs(approximate - exact));
+        }
+    }
+    return error;
+}
+
+double BondList::potentialEnergy(const NodeStore &s, LatticeInfo &latticeInfo) const
+{
+    /* The beam forces and moments of the kernels are minus the derivatives of
+       kappa_n/2 (d - d0)^2 + kappa_s d (Phi/24 (phi_ij - phi_ji)^2
+       + (phi_ij^2 + phi_ij phi_ji + phi_ji^2)/6), with the length d held
+       fixed in the bending term. Every beam is seen from both of its ends, so
+       the sum is halved.
+    */
+    const double kappa_n    = latticeInfo.kappa_n();
+    const double kappa_s    = latticeInfo.kappa_s();
+    const double Phi        = latticeInfo.Phi();
+    double energy = 0;
+    for (size_t i = 0; i+1 < offsets.size(); i++){
+        for (size_t b = offsets[i]; b < offsets[i+1]; b++){
+            const size_t j = neighbor[b];
+            const double rx = s.x[j] - s.x[i];
+            const double ry = s.y[j] - s.y[i];
+            const double dij = sqrt(rx*rx + ry*ry);
+            const double phiCorrection = rotation(b, rx, ry, dij);
+            const double phi_ij = s.phi[i] + phiCorrection;
+            const double phi_ji = s.phi[j] + phiCorrection;
+            energy += 0.5*kappa_n*(dij-d0[b])*(dij-d0[b])
+                    + kappa_s*dij*(Phi/24.0*(phi_ij-phi_ji)*(phi_ij-phi_ji)
+                                   + (phi_ij*phi_ij + phi_ij*phi_ji + phi_ji*phi_ji)/6.0);
+        }
+    }
+    return 0.5*energy;
+}
+
+double BondList::bendingWork(const NodeStore &s, LatticeInfo &latticeInfo,
+                             std::vector<double> &length, std::vector<double> &bending) const
+{
+    /* The bending energy kappa_s d B of a beam changes by kappa_s times
+       (d1+d0)/2 (B1-B0) + (B1+B0)/2 (d1-d0), exactly. The kernels apply the
+       first part, and the second is the work of the force they leave out,
+       done on the lattice as the beam stretches. Halved as in
+       potentialEnergy.
+    */
+    const double kappa_s = latticeInfo.kappa_s();
+    const double Phi     = latticeInfo.Phi();
+    const bool   filled  = length.size() == numBonds();
+    length.resize(numBonds());
+    bending.resize(numBonds());
+    double work = 0;
+    for (size_t i = 0; i+1 < offsets.size(); i++){
+        for (size_t b = offsets[i]; b < offsets[i+1]; b++){
+            const size_t j = neighbor[b];
+            const double rx = s.x[j] - s.x[i];
+            const double ry = s.y[j] - s.y[i];
+            const double dij = sqrt(rx*rx + ry*ry);
+            const double phiCorrection = rotation(b, rx, ry, dij);
+            const double phi_ij = s.phi[i] + phiCorrection;
+            const double phi_ji = s.phi[j] + phiCorrection;
+            const double factor = Phi/24.0*(phi_ij-phi_ji)*(phi_ij-phi_ji)
+                                + (phi_ij*phi_ij + phi_ij*phi_ji + phi_ji*phi_ji)/6.0;
+            if (filled)
+                work += 0.5*kappa_s*(factor + bending[b])*(dij - length[b]);
+            length[b]  = dij;
+            bending[b] = factor;
+        }
+    }
+    return 0.5*work;
+}
+
+void BondList::beamForce(const NodeStore &s, LatticeInfo &latticeInfo, size_t i,
+                         double &fx, double &fy, double &moment) const
+{
+    const double kappa_n = latticeInfo.kappa_n();
+    const double kappa_s = latticeInfo.kappa_s();
+    const double Phi     = latticeInfo.Phi();
+    fx = 0;
+    fy = 0;
+    moment = 0;
+    for (size_t b = offsets[i]; b < offsets[i+1]; b++){
+        const size_t j = neighbor[b];
+        const double rx = s.x[j] - s.x[i];
+        const double ry = s.y[j] - s.y[i];
+        const double dij = sqrt(rx*rx + ry*ry);
+        const double phiCorrection = rotation(b, rx, ry, dij);
+        const double phi_ij = s.phi[i] + phiCorrection;
+        const double phi_ji = s.phi[j] + phiCorrection;
+
+        const double fn = kappa_n*(dij-d0[b]);
+        const double fs = -kappa_s*0.5*(phi_ij + phi_ji);
+        moment += -kappa_s*dij*(Phi/12.0*(phi_ij-phi_ji)+0.5*(2.0/3.0*phi_ij+1.0/3.0*phi_ji));
+        fx += rx/dij*fn + (-ry)*fs/dij;
+        fy += ry/dij*fn + rx*fs/dij;
+    }
+}
+
+double BondList::rotation(size_t b, double rx, double ry, double dij) const
+{
+    if (m_rotation == Rotation::SMALL_ANGLE)
+        return smallAngleRotation(rx, ry, restX[b], restY[b], dij);
+    double phiCorrection = phiOffset[b] - atan2(ry, rx);
+    if (phiCorrection > pi)
+        phiCorrection -= 2*pi;
+    else if (phiCorrection <= -pi)
+        phiCorrection += 2*pi;
+    return phiCorrection;
+}
+
+const char* BondList::simdTarget()
+{
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return "avx512f";
+    if (__builtin_cpu_supports("avx2"))
+        return "avx2";
+#endif
+    return "default";
+}
+
+void BondList::updateForcesAndMoments(NodeStore &s, LatticeInfo &latticeInfo) const
+{
+    const double kappa_n = latticeInfo.kappa_n();
+    const double kappa_s = latticeInfo.kappa_s();
+    const double Phi     = latticeInfo.Phi();
+    switch (m_kernel) {
+    case Kernel::FULL:
+        updateForcesAndMomentsFull(s, kappa_n, kappa_s, Phi);
+        break;
+    case Kernel::HALF:
+        updateForcesAndMomentsHalf(s, kappa_n, kappa_s, Phi);
+        break;
+    case Kernel::SIMD:
+        updateForcesAndMomentsSimd(s, kappa_n, kappa_s, Phi);
+        break;
+    default:
+        break;
+    }
+}
+
+void BondList::updateForcesAndMomentsFull(NodeStore &s, double kappa_n, double kappa_s, double Phi) const
+{
+    const size_t numNodes   = s.size();
+    const bool   smallAngle = m_rotation == Rotation::SMALL_ANGLE;
+    const bool   damped     = isDamped();
+
+#pragma omp for schedule(runtime)
+    for (size_t i = 0; i < numNodes; i++){
+        double fx = 0;
+        double fy = 0;
+        double moment = 0;
+        // The damping is summed on its own and added last, as by the damper
+        double dampX = 0;
+        double dampY = 0;
+        if (damped)
+            RelativeVelocityDamperBatch::sum(s, *this, i, damping[i], dampX, dampY);
+        if (!s.isSetForce(i)){
+            const double xi   = s.x[i];
+            const double yi   = s.y[i];
+            const double phii = s.phi[i];
+            for (size_t b = offsets[i]; b < offsets[i+1]; b++){
+                const size_t j = neighbor[b];
+                const double rx = s.x[j] - xi;
+                const double ry = s.y[j] - yi;
+                const double dij = sqrt(rx*rx + ry*ry);
+
+                double phiCorrection;
+                if (smallAngle)
+                    phiCorrection = smallAngleRotation(rx, ry, restX[b], restY[b], dij);
+                else {
+                    phiCorrection = phiOffset[b] - atan2(ry, rx);
+                    if (phiCorrection > pi)
+                        phiCorrection -= 2*pi;
+                }
+
+                const double phi_ij = phii + phiCorrection;
+                const double phi_ji = s.phi[j] + phiCorrection;
+
+                const double fn = kappa_n*(dij-d0[b]);
+                const double fs = -kappa_s*0.5*(phi_ij + phi_ji);
+                const double m  = -kappa_s*dij*(Phi/12.0*(phi_ij-phi_ji)+0.5*(2.0/3.0*phi_ij+1.0/3.0*phi_ji));
+
+                moment += m;
+                fx += rx/dij*fn + (-ry)*fs/dij;
+                fy += ry/dij*fn + rx*fs/dij;
+            }
+        }
+        s.fx[i]     = fx + dampX;
+        s.fy[i]     = fy + dampY;
+        s.moment[i] = moment;
+    }
+}
+
+void BondList::updateForcesAndMomentsSimd(NodeStore &s, double kappa_n, double kappa_s, double Phi) const
+{
+    /* The nodes are shared out in blocks. The bonds of a block are evaluated
+       in one flat loop into a buffer of the thread, and then summed per node
+       in the order of the bonds, as in the full kernel.
+    */
+    const size_t numNodes  = s.size();
+    const size_t blockSize = 128;
+    const size_t numBlocks = (numNodes + blockSize - 1)/blockSize;
+    const bool   damped    = isDamped();
+    static thread_local std::vector<double> buffer;
+
+#pragma omp for schedule(runtime)
+    for (size_t block = 0; block < numBlocks; block++){
+        const size_t first = block*blockSize;
+        const size_t last  = std::min(first + blockSize, numNodes);
+        const size_t begin = offsets[first];
+        const size_t count = offsets[last] - begin;
+        if (buffer.size() < 3*count)
+            buffer.resize(3*count);
+        double *fx     = buffer.data();
+        double *fy     = fx + count;
+        double *moment = fy + count;
+        if (m_rotation == Rotation::SMALL_ANGLE)
+            beamKernel<true>(s.x.data(), s.y.data(), s.phi.data(), owner.data(), neighbor.data(), d0.data(),
+                             restX.data(), restY.data(), begin, begin + count, kappa_n, kappa_s, Phi,
+                             fx, fy, moment);
+        else
+            beamKernel<false>(s.x.data(), s.y.data(), s.phi.data(), owner.data(), neighbor.data(), d0.data(),
+                              restX.data(), restY.data(), begin, begin + count, kappa_n, kappa_s, Phi,
+                              fx, fy, moment);
+
+        for (size_t i = first; i < last; i++){
+            double fxi = 0;
+            double fyi = 0;
+            double mi  = 0;
+            if (!s.isSetForce(i)){
+                for (size_t b = offsets[i] - begin; b < offsets[i+1] - begin; b++){
+                    mi  += moment[b];
+                    fxi += fx[b];
+                    fyi += fy[b];
+                }
+            }
+            // The neighbors of the block are still in cache
+            if (damped){
+                double dampX = 0;
+                double dampY = 0;
+                RelativeVelocityDamperBatch::sum(s, *this, i, damping[i], dampX, dampY);
+                fxi += dampX;
+                fyi += dampY;
+            }
+            s.fx[i]     = fxi;
+            s.fy[i]     = fyi;
+            s.moment[i] = mi;
+        }
+    }
+}
+
+void BondList::updateForcesAndMomentsHalf(NodeStore &s, double kappa_n, double kappa_s, double Phi) const
+{
+    const size_t numNodes   = s.size();
+    const bool   smallAngle = m_rotation == Rotation::SMALL_ANGLE;
+    const bool   damped     = isDamped();
+#pragma omp for schedule(runtime)
+    for (size_t i = 0; i < numNodes; i++){
+        s.fx[i]     = 0;
+        s.fy[i]     = 0;
+        s.moment[i] = 0;
+    }
+
+    /* The beam (i, j) is evaluated from the end i. Seen from j, the beam
+       vector, and thus the force, changes sign, while the angle correction
+       is the same, so phi_ij and phi_ji swap roles in the moment.
+    */
+    for (size_t c = 0; c < numColors(); c++){
+        const size_t begin = colorOffsets[c];
+        const size_t end   = colorOffsets[c+1];
+#pragma omp for schedule(runtime)
+        for (size_t p = begin; p < end; p++){
+            const size_t i = pairFirst[p];
+            const size_t j = pairSecond[p];
+            const double rx = s.x[j] - s.x[i];
+            const double ry = s.y[j] - s.y[i];
+            const double dij = sqrt(rx*rx + ry*ry);
+
+            // Wrap to (-pi, pi] so both ends agree on the correction
+            double phiCorrection;
+            if (smallAngle)
+                phiCorrection = smallAngleRotation(rx, ry, pairRestX[p], pairRestY[p], dij);
+            else {
+                phiCorrection = pairPhiOffset[p] - atan2(ry, rx);
+                if (phiCorrection > pi)
+                    phiCorrection -= 2*pi;
+                else if (phiCorrection <= -pi)
+                    phiCorrection += 2*pi;
+            }
+
+            const double phi_ij = s.phi[i] + phiCorrection;
+            const double phi_ji = s.phi[j] + phiCorrection;
+
+            const double fn  = kappa_n*(dij-pairD0[p]);
+            const double fs  = -kappa_s*0.5*(phi_ij + phi_ji);
+            const double m_i = -kappa_s*dij*(Phi/12.0*(phi_ij-phi_ji)+0.5*(2.0/3.0*phi_ij+1.0/3.0*phi_ji));
+            const double m_j = -kappa_s*dij*(Phi/12.0*(phi_ji-phi_ij)+0.5*(2.0/3.0*phi_ji+1.0/3.0*phi_ij));
+            const double fx  = rx/dij*fn + (-ry)*fs/dij;
+            const double fy  = ry/dij*fn + rx*fs/dij;
+
+            if (!s.isSetForce(i)){
+                s.fx[i]     += fx;
+                s.fy[i]     += fy;
+                s.moment[i] += m_i;
+            }
+            if (!s.isSetForce(j)){
+                s.fx[j]     -= fx;
+                s.fy[j]     -= fy;
+                s.moment[j] += m_j;
+            }
+            // Added to the beam forces as they come, so not in the order of
+            // the damper
+            if (damped){
+                s.fx[i] += damping[i]*(s.vx[j] - s.vx[i]);
+                s.fy[i] += damping[i]*(s.vy[j] - s.vy[i]);
+                s.fx[j] += damping[j]*(s.vx[i] - s.vx[j]);
+                s.fy[j] += damping[j]*(s.vy[i] - s.vy[j]);
+            }
+        }
+    }
+}
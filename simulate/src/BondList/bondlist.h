@@ -0,0 +1,123 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "NodeStore/nodestore.h"
+
+class Node;
+class LatticeInfo;
+
+// The beams of the lattice in compressed sparse row format.
+// The bonds of node i are found at [offsets[i], offsets[i+1]), and for each
+// bond the index of the neighbor in the NodeStore, the rest length d0, the
+// initial angle phiOffset and the rest direction (restX, restY) as a unit
+// vector are stored in flat arrays.
+//
+// For the HALF kernel every beam is in addition stored once as a pair (i, j)
+// with i < j. The pairs are colored such that no two pairs of the same color
+// share a node, so each color can be processed in parallel without races.
+//
+// The rotation of a beam from its rest direction is by default found with
+// atan2. As the beams turn very little, the SMALL_ANGLE rotation instead
+// finds it from the cross and dot products of the current and the rest
+// direction, by a series without any transcendental function.
+//
+// The SIMD kernel evaluates the bonds of a block of nodes in one flat loop
+// the compiler can vectorize, and sums the results per node afterwards. It
+// stores the owner of every bond, and finds the angle correction as the
+// angle between the rest and the current direction without any branches.
+//
+// The kernels can add the damping of a RelativeVelocityDamper,
+// eta*sum(v_j - v_i) over the neighbors j of node i, when they find the
+// beam forces of the node. The coefficient eta is kept per node, and is 0
+// for the nodes without a fused damper. The full and simd kernels sum it
+// in a loop over the neighbors of its own, apart from the beams, with
+// RelativeVelocityDamperBatch::sum, which rounds as the damper does.
+class BondList
+{
+public:
+    enum class Kernel {
+        FULL, // Every beam is evaluated from both of its ends
+        HALF, // Every beam is evaluated once and the result applied to both ends
+        SIMD  // As FULL, with the bonds of many nodes evaluated in vector lanes
+    };
+
+    BondList();
+    enum class Rotation {
+        EXACT,       // atan2 of the beam vector, less the angle at rest
+        SMALL_ANGLE  // Series in tan(theta/2), accurate for small rotations
+    };
+
+    // Builds the list from the neighbor information of the nodes
+    void   build(const std::vector<std::shared_ptr<Node>> &nodes, size_t numNodes);
+    void   setKernel(Kernel kernel);
+    // Moves the arrays to memory placed by placement, see placement.h. The
+    // bonds of a node go with the node, and the pairs with the thread that
+    // evaluates them
+    void   place(Placement placement);
+    Kernel kernel() const {return m_kernel;}
+    void   setRotation(Rotation rotation) {m_rotation = rotation;}
+    Rotation rotation() const {return m_rotation;}
+    // The largest difference between the small angle and the exact rotation
+    // over all bonds, in radians. Serial, for checking the small angle
+    // rotation now and then
+    double rotationError(const NodeStore &store) const;
+    // The elastic energy of the beams, with the rotation used by the kernels.
+    // Serial, for checking the energy now and then
+    double potentialEnergy(const NodeStore &store, LatticeInfo &latticeInfo) const;
+    // The kernels hold the length of a beam fixed in its bending energy, so
+    // their forces leave out the part from the change of the length. Returns
+    // the work of that part since length and bending were filled, and fills
+    // them with the length and bending factor of every bond. Serial, for the
+    // energy balance of the lattice every step
+    double bendingWork(const NodeStore &store, LatticeInfo &latticeInfo,
+                       std::vector<double> &length, std::vector<double> &bending) const;
+    // The beam force and moment on node i as the kernels find them, also
+    // when the node has its force set. Serial
+    void   beamForce(const NodeStore &store, LatticeInfo &latticeInfo, size_t i,
+                     double &fx, double &fy, double &moment) const;
+    size_t numBonds() const {return neighbor.size();}
+    size_t numBonds(size_t i) const {return offsets[i+1] - offsets[i];}
+    size_t numColors() const {return colorOffsets.empty() ? 0 : colorOffsets.size()-1;}
+    // Lets the kernels apply the relative velocity damping of node i, with
+    // the neighbors of its bonds. clearDamping turns it off for every node
+    void   setDamping(size_t i, double eta);
+    void   clearDamping() {damping.clear();}
+    bool   isDamped() const {return !damping.empty();}
+    // Sets the force and moment of every node in the store to the sum of the
+    // beam forces and moments from its bonds. The work is shared by the
+    // threads of the enclosing parallel region, so every thread of the region
+    // must call it. Outside of a parallel region it runs serially
+    void   updateForcesAndMoments(NodeStore &store, LatticeInfo &latticeInfo) const;
+    // The instruction set the SIMD kernel runs with on this machine
+    static const char* simdTarget();
+
+    NodeStore::array<size_t> offsets;
+    NodeStore::array<size_t> neighbor;
+    NodeStore::array<double> d0;
+    NodeStore::array<double> phiOffset;
+
+    NodeStore::array<double> restX;
+    NodeStore::array<double> restY;
+    NodeStore::array<size_t> owner;
+    NodeStore::array<double> damping; // eta per node, empty if no node is damped
+
+    NodeStore::array<size_t> colorOffsets;
+    NodeStore::array<size_t> pairFirst;
+    NodeStore::array<size_t> pairSecond;
+    NodeStore::array<double> pairD0;
+    NodeStore::array<double> pairPhiOffset;
+    NodeStore::array<double> pairRestX;
+    NodeStore::array<double> pairRestY;
+private:
+    // The angle from the current to the rest direction of bond b, with the
+    // rotation of the kernels
+    double rotation(size_t b, double rx, double ry, double dij) const;
+    void buildPairs();
+    void buildSimd();
+    void updateForcesAndMomentsFull(NodeStore &store, double kappa_n, double kappa_s, double Phi) const;
+    void updateForcesAndMomentsHalf(NodeStore &store, double kappa_n, double kappa_s, double Phi) const;
+    void updateForcesAndMomentsSimd(NodeStore &store, double kappa_n, double kappa_s, double Phi) const;
+    Kernel   m_kernel   = Kernel::FULL;
+    Rotation m_rotation = Rotation::EXACT;
+};
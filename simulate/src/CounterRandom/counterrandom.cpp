@@ -0,0 +1,32 @@
+#include <vector>
+#include "counterrandom.h"
+
+CounterRandom::CounterRandom(uint64_t seed)
+    : m_seed(seed)
+{
+    m_key[0] = static_cast<uint32_t>(seed);
+    m_key[1] = static_cast<uint32_t>(seed >> 32);
+}
+
+void CounterRandom::normals(uint32_t c0, const uint32_t *c1, const uint32_t *c2, size_t n,
+                            double mean, double stddev, double *out) const
+{
+    /* The bits are found in vector lanes, with the uniform numbers kept in
+       out and u2. The logarithm and cosine have no vector versions without
+       -ffast-math, so the transform is a loop of its own.
+    */
+    static thread_local std::vector<double> u2;
+    u2.resize(n);
+#pragma omp simd
+    for (size_t k = 0; k < n; k++){
+        uint32_t w0 = c0;
+        uint32_t w1 = c1[k];
+        uint32_t w2 = c2[k];
+        uint32_t w3 = 0;
+        bits(w0, w1, w2, w3);
+        out[k] = uniform(w0, w1);
+        u2[k]  = uniform(w2, w3);
+    }
+    for (size_t k = 0; k < n; k++)
+        out[k] = mean + stddev*boxMuller(out[k], u2[k]);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+// Counter-based random numbers by Philox4x32-10 (Salmon et al., "Parallel
+// random numbers: as easy as 1, 2, 3", SC11).
+// The numbers are a function of a key, the seed, and a counter alone, and
+// the generator has no state. Any thread can draw the number belonging to a
+// counter in any order, so a run gives the same numbers whatever the number
+// of threads and however the work is shared between them.
+class CounterRandom
+{
+public:
+    explicit CounterRandom(uint64_t seed = 0);
+
+    // Replaces the counter (c0, c1, c2, c3) by its four words of random bits
+    inline void bits(uint32_t &c0, uint32_t &c1, uint32_t &c2, uint32_t &c3) const;
+    // A number drawn from the standard normal distribution for the counter
+    // (c0, c1, c2), by the Box-Muller transform of the bits
+    inline double normal(uint32_t c0, uint32_t c1, uint32_t c2) const;
+    // Draws n numbers from the normal distribution with the given mean and
+    // standard deviation, number k for the counter (c0, c1[k], c2[k])
+    void normals(uint32_t c0, const uint32_t *c1, const uint32_t *c2, size_t n,
+                 double mean, double stddev, double *out) const;
+    uint64_t seed() const {return m_seed;}
+
+private:
+    // A uniform number of 53 bits in (0, 1), so its logarithm is finite
+    static double uniform(uint32_t high, uint32_t low)
+    {
+        const uint64_t word = (static_cast<uint64_t>(high) << 21) ^ (low >> 11);
+        return (static_cast<double>(word) + 0.5)*(1.0/9007199254740992.0);
+    }
+    static double boxMuller(double u1, double u2)
+    {
+        return std::sqrt(-2.0*std::log(u1))*std::cos(6.283185307179586477*u2);
+    }
+
+    uint64_t m_seed;
+    uint32_t m_key[2];
+};
+
+void CounterRandom::bits(uint32_t &c0, uint32_t &c1, uint32_t &c2, uint32_t &c3) const
+{
+    uint32_t k0 = m_key[0];
+    uint32_t k1 = m_key[1];
+    for (int round = 0; round < 10; round++){
+        const uint64_t p0 = static_cast<uint64_t>(0xD2511F53u)*c0;
+        const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u)*c2;
+        const uint32_t hi0 = static_cast<uint32_t>(p0 >> 32);
+        const uint32_t hi1 = static_cast<uint32_t>(p1 >> 32);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = static_cast<uint32_t>(p1);
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = static_cast<uint32_t>(p0);
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+}
+
+double CounterRandom::normal(uint32_t c0, uint32_t c1, uint32_t c2) const
+{
+    uint32_t c3 = 0;
+    bits(c0, c1, c2, c3);
+    return boxMuller(uniform(c0, c1), uniform(c2, c3));
+}
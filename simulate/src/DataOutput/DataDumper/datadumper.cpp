@@ -25,6 +25,7 @@ DataDumper::DataDumper(const std::string& outputPath)
      systemPath("system"),
      parametersPath("parameters"),
      latticePath("lattice.xyz"),
+     latticeBinaryPath("lattice.xyzb"),
      dumpPath("info/")
 {
     this->outputPath = outputPath;
@@ -98,3 +99,11 @@ void DataDumper::dumpLatticeStructure(const std::shared_ptr<Lattice> lattice){
     file << lattice->xyzRepresentation();
     file.close();
 }
+
+void DataDumper::dumpLatticeBinary(const std::shared_ptr<Lattice> lattice,
+                                   const std::shared_ptr<Parameters> params){
+    BinaryLattice binary = lattice->binaryRepresentation(params->get<int>("nx"),
+                                                         params->get<int>("ny"),
+                                                         params->get<double>("d"));
+    binary.write(outputPath+latticeBinaryPath);
+}
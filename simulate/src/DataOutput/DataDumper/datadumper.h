@@ -18,12 +18,14 @@ public:
     void dumpSystem(const FrictionSystem*);
     void dumpParameters(const std::shared_ptr<Parameters>);
     void dumpLatticeStructure(const std::shared_ptr<Lattice>);
+    void dumpLatticeBinary(const std::shared_ptr<Lattice>, const std::shared_ptr<Parameters>);
 
     std::string frictionInfoPath;
     std::string latticeInfoPath;
     std::string systemPath;
     std::string parametersPath;
     std::string latticePath;
+    std::string latticeBinaryPath;
     std::string outputPath;
     std::string dumpPath;
 };
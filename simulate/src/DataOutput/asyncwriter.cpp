@@ -0,0 +1,97 @@
+#include <iostream>
+#include "asyncwriter.h"
+#include "ThreadConfig/threadconfig.h"
+
+AsyncWriter::AsyncWriter(size_t capacity)
+    :m_ring(capacity)
+{
+    if (capacity > 0)
+        m_thread = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    if (!m_thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+    }
+    m_notEmpty.notify_one();
+    m_thread.join();
+    if (m_error){
+        try {
+            std::rethrow_exception(m_error);
+        } catch (std::exception &ex) {
+            std::cerr << "Error> Writing output failed: " << ex.what() << std::endl;
+        } catch (...) {
+            std::cerr << "Error> Writing output failed" << std::endl;
+        }
+    }
+}
+
+void AsyncWriter::push(std::function<void()> job)
+{
+    if (m_ring.empty()){
+        job();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_notFull.wait(lock, [this]{return m_count < m_ring.size() || m_error;});
+    rethrow();
+    m_ring[(m_head + m_count) % m_ring.size()] = std::move(job);
+    m_count++;
+    lock.unlock();
+    m_notEmpty.notify_one();
+}
+
+void AsyncWriter::flush()
+{
+    if (m_ring.empty())
+        return;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_notFull.wait(lock, [this]{return (m_count == 0 && !m_busy) || m_error;});
+    rethrow();
+}
+
+void AsyncWriter::rethrow()
+{
+    // Must be called with the mutex held
+    if (m_error){
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void AsyncWriter::run()
+{
+    // Do not compete with the simulation thread for its core
+    ThreadConfig::unpinCurrentThread();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true){
+        m_notEmpty.wait(lock, [this]{return m_count > 0 || m_done;});
+        if (m_count == 0)
+            return;
+        std::function<void()> job = std::move(m_ring[m_head]);
+        m_ring[m_head] = nullptr;
+        m_head = (m_head + 1) % m_ring.size();
+        m_count--;
+        m_busy = true;
+
+        // Do the I/O without holding the lock
+        lock.unlock();
+        m_notFull.notify_all();
+        std::exception_ptr error;
+        try {
+            job();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        m_busy = false;
+        if (error && !m_error)
+            m_error = error;
+        m_notFull.notify_all();
+    }
+}
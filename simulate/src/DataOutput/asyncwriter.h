@@ -0,0 +1,47 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs output jobs in order on a background thread.
+// The jobs are kept in a bounded ring buffer. When it is full, push() blocks
+// until the writer has caught up, so a slow filesystem throttles the
+// simulation instead of exhausting the memory. A capacity of 0 runs every
+// job synchronously in push().
+// Errors thrown by a job are rethrown on the simulation thread by the next
+// call to push() or flush().
+class AsyncWriter
+{
+public:
+    explicit AsyncWriter(size_t capacity);
+    // Waits for all of the queued jobs to finish
+    ~AsyncWriter();
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    void push(std::function<void()> job);
+    // Blocks until every job pushed so far has been run
+    void flush();
+
+private:
+    void run();
+    void rethrow();
+
+    std::vector<std::function<void()>> m_ring;
+    size_t                             m_head    = 0; // Next job to run
+    size_t                             m_count   = 0; // Jobs in the ring
+    bool                               m_busy    = false;
+    bool                               m_done    = false;
+    std::exception_ptr                 m_error;
+    std::mutex                         m_mutex;
+    std::condition_variable            m_notEmpty;
+    std::condition_variable            m_notFull;
+    std::thread                        m_thread;
+};
+
+#endif /* ASYNCWRITER_H */
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "chunkedfile.h"
+
+namespace {
+const size_t headerSize = 40;
+const size_t columnSize = 72;
+const size_t nameSize   = 32;
+
+template <typename T>
+void put(std::ofstream &stream, T value){
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+}
+
+ChunkedFile::ChunkedFile(const std::string &path, size_t chunkSize,
+                         Compressor::Mode compression, double tolerance)
+    : m_path(path), m_chunkSize(chunkSize), m_compression(compression), m_tolerance(tolerance)
+{
+    if (m_chunkSize < sizeof(double))
+        throw std::runtime_error("The chunk size must hold at least one number");
+    m_stream.open(m_path, std::ios::out | std::ios::binary);
+    if (!(m_stream.is_open() && m_stream.good())){
+        std::cerr << "Outputfile " << m_path << " could not be opened." << std::endl;
+        throw std::runtime_error("Could not open outputfile.");
+    }
+}
+
+ChunkedFile::~ChunkedFile()
+{
+    if (!is_open())
+        return;
+    try {
+        close();
+    } catch (const std::exception &e) {
+        std::cerr << "Error> Could not close " << m_path << ": " << e.what() << std::endl;
+    }
+}
+
+void ChunkedFile::addColumn(DataPacket::dataId id, const std::string &name, unsigned int period)
+{
+    if (m_started)
+        throw std::runtime_error("Columns must be added before writing to " + m_path);
+    if (name.size() >= nameSize)
+        throw std::runtime_error("Column name " + name + " is too long");
+    Column column(m_compression, m_tolerance);
+    column.id     = static_cast<uint32_t>(id);
+    column.period = period;
+    column.name   = name;
+    m_columns.push_back(std::move(column));
+}
+
+ChunkedFile::Column& ChunkedFile::column(DataPacket::dataId id)
+{
+    for (auto & column : m_columns)
+        if (column.id == static_cast<uint32_t>(id))
+            return column;
+    throw std::runtime_error("No column for the data id in " + m_path);
+}
+
+void ChunkedFile::write(const DataPacket &packet)
+{
+    if (!m_started){
+        // The data begins after the header. Reserve its place for close()
+        writeHeader(0);
+        m_end = headerSize + columnSize*m_columns.size();
+        m_started = true;
+    }
+    Column &col = column(packet.id());
+    if (packet.timestep() % col.period != 0)
+        return;
+
+    const std::vector<double> &data = packet.data();
+    if (col.numRecords == 0){
+        if (data.empty())
+            throw std::runtime_error("Can not write the empty column " + col.name);
+        col.count         = data.size();
+        col.chunkLength   = std::max<uint64_t>(1, m_chunkSize/(col.count*sizeof(double)));
+        col.firstTimestep = packet.timestep();
+        col.chunk.reserve(col.chunkLength*col.count);
+    } else {
+        if (data.size() != col.count)
+            throw std::runtime_error("The records of " + col.name + " change in size");
+        if (packet.timestep() != col.firstTimestep + static_cast<int64_t>(col.numRecords*col.period))
+            throw std::runtime_error("The records of " + col.name + " are not evenly spaced");
+    }
+
+    if (col.chunk.empty()){
+        col.chunkTimesteps.push_back(packet.timestep());
+        col.chunkOffsets.push_back(0);
+        col.chunkSizes.push_back(0);
+    }
+    col.chunk.insert(col.chunk.end(), data.begin(), data.end());
+    col.numRecords++;
+    if (col.chunk.size() == col.chunkLength*col.count)
+        writeChunk(col);
+}
+
+void ChunkedFile::writeChunk(Column &col)
+{
+    col.compressor.encode(col.chunk, col.count, m_encoded);
+    col.chunkOffsets.back() = m_end;
+    col.chunkSizes.back()   = m_encoded.size();
+    m_stream.seekp(static_cast<std::streamoff>(m_end));
+    m_stream.write(m_encoded.data(), static_cast<std::streamsize>(m_encoded.size()));
+    m_end += m_encoded.size();
+    col.chunk.clear();
+    if (!m_stream.good())
+        throw std::runtime_error("Could not write to " + m_path);
+}
+
+void ChunkedFile::close()
+{
+    if (!is_open())
+        return;
+    if (!m_started){
+        writeHeader(0);
+        m_end = headerSize + columnSize*m_columns.size();
+        m_started = true;
+    }
+    for (auto & col : m_columns)
+        if (!col.chunk.empty())
+            writeChunk(col);
+
+    const uint64_t indexOffset = m_end;
+    m_stream.seekp(static_cast<std::streamoff>(indexOffset));
+    for (const auto & col : m_columns){
+        put<uint64_t>(m_stream, col.chunkOffsets.size());
+        for (size_t c = 0; c < col.chunkOffsets.size(); c++){
+            put<int64_t>(m_stream, col.chunkTimesteps[c]);
+            put<uint64_t>(m_stream, col.chunkOffsets[c]);
+            put<uint64_t>(m_stream, col.chunkSizes[c]);
+        }
+    }
+    writeHeader(indexOffset);
+    m_stream.close();
+    if (m_stream.fail())
+        throw std::runtime_error("Could not write to " + m_path);
+    if (m_compression != Compressor::Mode::NONE)
+        report();
+}
+
+void ChunkedFile::report() const
+{
+    uint64_t bytesIn  = 0;
+    uint64_t bytesOut = 0;
+    std::cout << "Compressed " << m_path << " with " << Compressor::name(m_compression) << std::endl;
+    for (const auto & col : m_columns){
+        if (col.numRecords == 0)
+            continue;
+        bytesIn  += col.compressor.bytesIn();
+        bytesOut += col.compressor.bytesOut();
+        std::cout << "    " << col.name << ": ratio " << col.compressor.ratio()
+                  << ", " << col.compressor.throughput() << " MB/s" << std::endl;
+    }
+    std::cout << "    " << static_cast<double>(bytesIn)/1e6 << " MB to "
+              << static_cast<double>(bytesOut)/1e6 << " MB" << std::endl;
+}
+
+void ChunkedFile::writeHeader(uint64_t indexOffset)
+{
+    m_stream.seekp(0);
+    m_stream.write("FCHK", 4);
+    put<uint32_t>(m_stream, version);
+    put<uint32_t>(m_stream, static_cast<uint32_t>(m_columns.size()));
+    put<uint32_t>(m_stream, static_cast<uint32_t>(std::min<size_t>(m_chunkSize, UINT32_MAX)));
+    put<uint64_t>(m_stream, indexOffset);
+    put<uint32_t>(m_stream, static_cast<uint32_t>(m_compression));
+    put<uint32_t>(m_stream, 0);
+    put<double>(m_stream, m_tolerance);
+    for (const auto & col : m_columns){
+        put<uint32_t>(m_stream, col.id);
+        put<uint32_t>(m_stream, col.period);
+        put<uint64_t>(m_stream, col.count);
+        put<uint64_t>(m_stream, col.numRecords);
+        put<uint64_t>(m_stream, col.chunkLength);
+        put<int64_t>(m_stream, col.firstTimestep);
+        char name[nameSize] = {};
+        std::strncpy(name, col.name.c_str(), nameSize-1);
+        m_stream.write(name, nameSize);
+    }
+    if (!m_stream.good())
+        throw std::runtime_error("Could not write to " + m_path);
+}
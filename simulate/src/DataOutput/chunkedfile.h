@@ -0,0 +1,84 @@
+#ifndef CHUNKEDFILE_H
+#define CHUNKEDFILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "datapacket.h"
+#include "compressor.h"
+
+// A single self-describing output file holding every data id as a column.
+//
+// Layout, in native byte order:
+//   Header    char magic[4] = "FCHK", uint32 version, uint32 numColumns,
+//             uint32 chunkSize (bytes), uint64 indexOffset,
+//             uint32 compression (Compressor::Mode), uint32 unused,
+//             double tolerance
+//   Columns   numColumns entries of 72 bytes:
+//             uint32 id, uint32 period, uint64 count (numbers per record),
+//             uint64 numRecords, uint64 chunkLength (records per chunk),
+//             int64 firstTimestep, char name[32]
+//   Chunks    chunkLength consecutive records of one column, encoded by
+//             the Compressor
+//   Index     at indexOffset, for every column: uint64 numChunks followed by
+//             numChunks entries of int64 firstTimestep, uint64 offset,
+//             uint64 size (bytes stored)
+//
+// Record k of a column holds the timestep firstTimestep + k*period and lies in
+// chunk k/chunkLength, so a reader finds any timestep of a column in O(1).
+// The header is written before the first record and completed by close().
+// An indexOffset of 0 means the file was never closed.
+class ChunkedFile
+{
+public:
+    static const uint32_t version = 2;
+
+    ChunkedFile(const std::string &path, size_t chunkSize,
+                Compressor::Mode compression = Compressor::Mode::NONE, double tolerance = 0);
+    ~ChunkedFile();
+    ChunkedFile(const ChunkedFile&) = delete;
+    ChunkedFile& operator=(const ChunkedFile&) = delete;
+
+    // Columns must be added before the first write
+    void addColumn(DataPacket::dataId id, const std::string &name, unsigned int period);
+    void write(const DataPacket &packet);
+    // Writes the remaining chunks, the index and the final header, and
+    // reports how well the columns were compressed
+    void close();
+    bool is_open() const {return m_stream.is_open();}
+
+private:
+    struct Column {
+        uint32_t            id;
+        uint32_t            period;
+        std::string         name;
+        uint64_t            count         = 0;
+        uint64_t            numRecords    = 0;
+        uint64_t            chunkLength   = 0;
+        int64_t             firstTimestep = 0;
+        std::vector<double> chunk;
+        std::vector<int64_t>  chunkTimesteps;
+        std::vector<uint64_t> chunkOffsets;
+        std::vector<uint64_t> chunkSizes;
+        Compressor            compressor;
+        Column(Compressor::Mode mode, double tolerance) : compressor(mode, tolerance) {}
+    };
+
+    void writeHeader(uint64_t indexOffset);
+    void writeChunk(Column &column);
+    void report() const;
+    Column& column(DataPacket::dataId id);
+
+    std::ofstream       m_stream;
+    std::string         m_path;
+    size_t              m_chunkSize;
+    Compressor::Mode    m_compression;
+    double              m_tolerance;
+    std::vector<char>   m_encoded;
+    uint64_t            m_end = 0;
+    bool                m_started = false;
+    std::vector<Column> m_columns;
+};
+
+#endif /* CHUNKEDFILE_H */
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+#include "compressor.h"
+
+namespace {
+// Deflate level 1. The output is limited by the disk, but the compression
+// runs on the writer thread and has to keep up with the simulation
+const int deflateLevel = Z_BEST_SPEED;
+
+uint64_t toWord(double number){
+    uint64_t word;
+    std::memcpy(&word, &number, sizeof(word));
+    return word;
+}
+
+// Maps signed differences to unsigned, with small magnitudes to small numbers
+uint64_t zigzag(int64_t value){
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+}
+
+Compressor::Compressor(Mode mode, double tolerance)
+    : m_mode(mode), m_tolerance(tolerance)
+{
+    if (m_mode == Mode::QUANTIZE && !(m_tolerance > 0))
+        throw std::runtime_error("The tolerance of the quantization must be positive");
+}
+
+Compressor::Mode Compressor::mode(const std::string &name)
+{
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "none")
+        return Mode::NONE;
+    else if (lower == "shuffle")
+        return Mode::SHUFFLE;
+    else if (lower == "xor")
+        return Mode::XOR;
+    else if (lower == "quantize")
+        return Mode::QUANTIZE;
+    else
+        throw std::runtime_error("outputCompression is not recognized");
+}
+
+std::string Compressor::name(Mode mode)
+{
+    switch (mode) {
+    case Mode::NONE:
+        return "none";
+    case Mode::SHUFFLE:
+        return "shuffle";
+    case Mode::XOR:
+        return "xor";
+    case Mode::QUANTIZE:
+        return "quantize";
+    default:
+        throw std::runtime_error("Unknown compression mode");
+    }
+}
+
+void Compressor::encode(const std::vector<double> &numbers, size_t count, std::vector<char> &out)
+{
+    auto start = std::chrono::steady_clock::now();
+    const size_t n = numbers.size();
+    m_words.resize(n);
+    switch (m_mode) {
+    case Mode::NONE:
+    case Mode::SHUFFLE:
+        for (size_t i = 0; i < n; i++)
+            m_words[i] = toWord(numbers[i]);
+        break;
+    case Mode::XOR:
+        for (size_t i = 0; i < n; i++)
+            m_words[i] = toWord(numbers[i]) ^ (i >= count ? toWord(numbers[i-count]) : 0);
+        break;
+    case Mode::QUANTIZE:{
+        // The integers are held in m_words until they are replaced by the differences
+        const double limit = 4.0e18;
+        for (size_t i = 0; i < n; i++){
+            const double q = std::round(numbers[i]/m_tolerance);
+            if (!(std::fabs(q) < limit))
+                throw std::runtime_error("Can not quantize a number to the tolerance");
+            m_words[i] = static_cast<uint64_t>(static_cast<int64_t>(q));
+        }
+        for (size_t i = n; i-- > count;)
+            m_words[i] = zigzag(static_cast<int64_t>(m_words[i] - m_words[i-count]));
+        for (size_t i = 0; i < std::min(count, n); i++)
+            m_words[i] = zigzag(static_cast<int64_t>(m_words[i]));
+        break;
+    }
+    default:
+        throw std::runtime_error("Unknown compression mode");
+    }
+
+    if (m_mode == Mode::NONE){
+        out.resize(n*sizeof(uint64_t));
+        std::memcpy(out.data(), m_words.data(), out.size());
+    } else {
+        // Byte b of every word goes to plane b
+        m_shuffled.resize(n*sizeof(uint64_t));
+        for (size_t b = 0; b < sizeof(uint64_t); b++){
+            char *plane = m_shuffled.data() + b*n;
+            for (size_t i = 0; i < n; i++)
+                plane[i] = static_cast<char>((m_words[i] >> (8*b)) & 0xff);
+        }
+        deflate(out);
+    }
+
+    m_bytesIn  += n*sizeof(double);
+    m_bytesOut += out.size();
+    m_seconds  += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Compressor::deflate(std::vector<char> &out)
+{
+    uLongf size = compressBound(static_cast<uLong>(m_shuffled.size()));
+    out.resize(size);
+    int rc = compress2(reinterpret_cast<Bytef*>(out.data()), &size,
+                       reinterpret_cast<const Bytef*>(m_shuffled.data()),
+                       static_cast<uLong>(m_shuffled.size()), deflateLevel);
+    if (rc != Z_OK)
+        throw std::runtime_error("Could not compress the output");
+    out.resize(size);
+}
+
+double Compressor::ratio() const
+{
+    return m_bytesOut > 0 ? static_cast<double>(m_bytesIn)/static_cast<double>(m_bytesOut) : 1.0;
+}
+
+double Compressor::throughput() const
+{
+    return m_seconds > 0 ? static_cast<double>(m_bytesIn)/1e6/m_seconds : 0.0;
+}
@@ -0,0 +1,66 @@
+#ifndef COMPRESSOR_H
+#define COMPRESSOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Encodes the chunks of a ChunkedFile.
+// A chunk is a number of consecutive records of one column, each of count
+// numbers. Every chunk is encoded on its own, so a reader can decode any
+// chunk without the ones before it.
+//
+//   NONE      The doubles as they are
+//   SHUFFLE   The bytes of the doubles are grouped by significance, so the
+//             exponent and leading mantissa bytes, which vary little, are
+//             next to each other, and the result is deflated (zlib)
+//   XOR       Each record is XORed with the previous record of the chunk
+//             before shuffling and deflating. Numbers that change slightly
+//             between dumps share their leading bits, which become zero
+//   QUANTIZE  Each number is rounded to a multiple of the tolerance. The
+//             integers are stored as the difference to the previous record
+//             before shuffling and deflating. Lossy, the error is at most
+//             half the tolerance
+//
+// The compressor keeps count of the bytes in and out and of the time spent,
+// to report the ratio and throughput of the mode.
+class Compressor
+{
+public:
+    enum class Mode : uint32_t {
+        NONE     = 0,
+        SHUFFLE  = 1,
+        XOR      = 2,
+        QUANTIZE = 3
+    };
+
+    Compressor(Mode mode, double tolerance);
+    // Parses the name of a mode, as given by the outputCompression parameter
+    static Mode        mode(const std::string &name);
+    static std::string name(Mode mode);
+
+    // Encodes numbers, which is a whole number of records of count numbers,
+    // into out
+    void encode(const std::vector<double> &numbers, size_t count, std::vector<char> &out);
+
+    Mode     mode()        const {return m_mode;}
+    double   tolerance()   const {return m_tolerance;}
+    uint64_t bytesIn()     const {return m_bytesIn;}
+    uint64_t bytesOut()    const {return m_bytesOut;}
+    double   ratio()       const;
+    // Megabytes of input encoded per second
+    double   throughput()  const;
+
+private:
+    void deflate(std::vector<char> &out);
+
+    Mode                  m_mode;
+    double                m_tolerance;
+    std::vector<uint64_t> m_words;
+    std::vector<char>     m_shuffled;
+    uint64_t              m_bytesIn  = 0;
+    uint64_t              m_bytesOut = 0;
+    double                m_seconds  = 0;
+};
+
+#endif /* COMPRESSOR_H */
@@ -1,15 +1,30 @@
 
 #include "datapacket.h"
+#include "packetpool.h"
 
 DataPacket::DataPacket(DataPacket::dataId id, int timeStep, double time) :
     m_id(id),
     m_timeStep(timeStep),
-    m_time(time)
+    m_time(time),
+    m_data(std::make_shared<std::vector<double>>())
 {
 
 }
 
-void DataPacket::push_back(double number)
+DataPacket::DataPacket(DataPacket::dataId id, int timeStep, double time, Buffer buffer) :
+    m_id(id),
+    m_timeStep(timeStep),
+    m_time(time),
+    m_data(buffer)
+{
+
+}
+
+DataPacket::Buffer DataRequest::buffer(size_t capacity) const
 {
-    m_data.push_back(number);
+    if (m_pool)
+        return m_pool->acquire(capacity);
+    auto buffer = std::make_shared<std::vector<double>>();
+    buffer->reserve(capacity);
+    return buffer;
 }
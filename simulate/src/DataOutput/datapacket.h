@@ -1,11 +1,20 @@
 #ifndef DATAPACKET_H
 #define DATAPACKET_H
 
+#include <bitset>
+#include <memory>
 #include <vector>
 
+class PacketPool;
+
+// A block of output data for one timestep.
+// Copies of a packet share its buffer, so packets are cheap to pass around,
+// but must not be filled further once they are handed to the DataPacketHandler
 class DataPacket
 {
 public:
+    typedef std::shared_ptr<std::vector<double>> Buffer;
+
     enum class dataId {
         INTERFACE_POSITION,
         INTERFACE_VELOCITY,
@@ -18,24 +27,46 @@ public:
         ALL_FORCE,
         PUSHER_FORCE,
         BEAM_TORQUE,
-        BEAM_SHEAR_FORCE
+        BEAM_SHEAR_FORCE,
+        INTERFACE_CONTACT_EVENTS
     };
+    static const size_t numIds = 13;
 
 
     DataPacket(DataPacket::dataId id, int timeStep, double time);
-    void push_back(double number);
+    // Fills the given buffer, typically from DataRequest::buffer
+    DataPacket(DataPacket::dataId id, int timeStep, double time, Buffer buffer);
+    void push_back(double number) {m_data->push_back(number);}
 
-    dataId id()                const {return m_id;}
-    int    timestep()          const {return m_timeStep;}
-    double time()              const {return m_time;}
-    std::vector<double> data() const {return m_data;}
+    dataId id()                        const {return m_id;}
+    int    timestep()                  const {return m_timeStep;}
+    double time()                      const {return m_time;}
+    const std::vector<double>& data()  const {return *m_data;}
 
 private:
     dataId m_id;
     int    m_timeStep;
     double m_time;
 
-    std::vector<double> m_data;
+    Buffer m_data;
+};
+
+// The set of data ids a producer is asked to fill at a timestep.
+// Producers skip gathering the data of packets that are not requested,
+// and take the buffers of the packets they build from buffer()
+class DataRequest
+{
+public:
+    explicit DataRequest(std::shared_ptr<PacketPool> pool = nullptr) : m_pool(pool) {}
+    void add(DataPacket::dataId id)        {m_ids.set(static_cast<size_t>(id));}
+    void addAll()                          {m_ids.set();}
+    bool wants(DataPacket::dataId id) const {return m_ids.test(static_cast<size_t>(id));}
+    bool any()                        const {return m_ids.any();}
+    // An empty buffer with room for capacity numbers, recycled if there is a pool
+    DataPacket::Buffer buffer(size_t capacity) const;
+private:
+    std::bitset<DataPacket::numIds> m_ids;
+    std::shared_ptr<PacketPool>     m_pool;
 };
 
 #endif // DATAPACKET_H
@@ -1,9 +1,13 @@
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <stdio.h>
 #include <stdexcept>
 #include "datapackethandler.h"
 #include "filewrapper.h"
+#include "chunkedfile.h"
+#include "asyncwriter.h"
+#include "packetpool.h"
 #include "FrictionSystem/SidePotentialLoading/sidepotentialloading.h"
 #include "mkdir.h"
 
@@ -33,6 +37,20 @@ DataPacketHandler::DataPacketHandler(const std::string &outputFolder, std::share
     makeDirectory(outputDirectory);
     makeDirectory(snapshotDirectory);
     parameters = pParameters;
+    auto format = parameters->get<std::string>("outputFormat");
+    std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+    if (format == "chunked"){
+        int chunkSize = parameters->get<int>("outputChunkSize");
+        if (chunkSize <= 0)
+            throw std::runtime_error("outputChunkSize must be positive");
+        auto compression = Compressor::mode(parameters->get<std::string>("outputCompression"));
+        chunkedFile = make_unique<ChunkedFile>(outputDirectory+"data.fchk", static_cast<size_t>(chunkSize),
+                                               compression, parameters->get<double>("outputTolerance"));
+    }
+    else if (format != "raw")
+        throw std::runtime_error("outputFormat is not recognized");
+    else if (Compressor::mode(parameters->get<std::string>("outputCompression")) != Compressor::Mode::NONE)
+        throw std::runtime_error("outputCompression requires outputFormat chunked");
     // Handle binary files
     addBinary(DataPacket::dataId::INTERFACE_POSITION         , "interfacePosition");
     addBinary(DataPacket::dataId::INTERFACE_VELOCITY         , "interfaceVelocity");
@@ -46,18 +64,27 @@ DataPacketHandler::DataPacketHandler(const std::string &outputFolder, std::share
     addBinary(DataPacket::dataId::BEAM_SHEAR_FORCE           , "beamShearForce");
     addBinary(DataPacket::dataId::BEAM_TORQUE                , "beamTorque");
     addBinary(DataPacket::dataId::PUSHER_FORCE               , "pusherForce");
+    addBinary(DataPacket::dataId::INTERFACE_CONTACT_EVENTS   , "interfaceContactEvents");
     // Handle xyz files
     doWriteXYZ = parameters->get<bool>("writeXYZ");
     if (doWriteXYZ){
         ofXYZ.open(outputDirectory+"model.xyz", std::ofstream::out);
         freqXYZ = parameters->get<int>("freqXYZ");
     }
+    int queueLength = parameters->get<int>("outputQueueLength");
+    if (queueLength < 0)
+        throw std::runtime_error("outputQueueLength must be non-negative");
+    writer = make_unique<AsyncWriter>(static_cast<size_t>(queueLength));
+    pool   = std::make_shared<PacketPool>();
 }
 
 DataPacketHandler::~DataPacketHandler()
 {
+    // Let the writer finish before the files are closed
+    writer.reset();
     for(auto& element: fileMap)
         element.second->stream.close();
+    chunkedFile.reset();
 }
 
 void DataPacketHandler::addBinary(DataPacket::dataId id, const std::string &name){
@@ -69,8 +96,13 @@ void DataPacketHandler::addBinary(DataPacket::dataId id, const std::string &name
     auto file = make_unique<FileWrapper>();
     file->name = name;
     file->period = parameters->get<int>("freq"+Name);
-    if (parameters->get<bool>("write"+Name))
-        file->open(path, std::ios::out | std::ios::binary);
+    if (parameters->get<bool>("write"+Name)){
+        periods[id] = file->period;
+        if (chunkedFile)
+            chunkedFile->addColumn(id, name, file->period);
+        else
+            file->open(path, std::ios::out | std::ios::binary);
+    }
     fileMap[id] = std::move(file);
 
     // Make snapshot files
@@ -84,26 +116,55 @@ void DataPacketHandler::addBinary(DataPacket::dataId id, const std::string &name
 
 void DataPacketHandler::step(std::vector<DataPacket> packets)
 {
-    for (DataPacket & packet: packets)
-        fileMap[packet.id()]->write(packet);
+    auto pPackets = std::make_shared<std::vector<DataPacket>>(std::move(packets));
+    writer->push([this, pPackets](){
+        for (DataPacket & packet: *pPackets){
+            if (chunkedFile){
+                if (periods.count(packet.id()))
+                    chunkedFile->write(packet);
+            }
+            else
+                fileMap.at(packet.id())->write(packet);
+        }
+    });
+}
+
+DataRequest DataPacketHandler::due(int timestep) const
+{
+    DataRequest request(pool);
+    for (const auto& element: periods)
+        if (timestep % element.second == 0)
+            request.add(element.first);
+    return request;
 }
 
 void DataPacketHandler::dumpXYZ(const std::string &xyzstring){
-    ofXYZ << xyzstring;
+    auto pXYZ = std::make_shared<std::string>(xyzstring);
+    writer->push([this, pXYZ](){
+        ofXYZ << *pXYZ;
+    });
 }
 
 void DataPacketHandler::dumpSnapshot(std::vector<DataPacket> packets,
                                      const std::string& xyz){
-    for(auto& element: snapshotFiles)
-        element.second->open();
-    for(const auto& packet: packets)
-        snapshotFiles[packet.id()]->write(packet);
-    for(auto& element: snapshotFiles)
-        element.second->close();
-    std::cout << std::endl;
+    auto pPackets = std::make_shared<std::vector<DataPacket>>(std::move(packets));
+    auto pXYZ     = std::make_shared<std::string>(xyz);
+    writer->push([this, pPackets, pXYZ](){
+        for(auto& element: snapshotFiles)
+            element.second->open();
+        for(const auto& packet: *pPackets)
+            snapshotFiles.at(packet.id())->write(packet);
+        for(auto& element: snapshotFiles)
+            element.second->close();
+        std::cout << std::endl;
+
+        std::ofstream xyzStream;
+        xyzStream.open(snapshotDirectory+"model.xyz", std::ofstream::out);
+        xyzStream << *pXYZ;
+        xyzStream.close();
+    });
+}
 
-    std::ofstream xyzStream;
-    xyzStream.open(snapshotDirectory+"model.xyz", std::ofstream::out);
-    xyzStream << xyz;
-    xyzStream.close();
+void DataPacketHandler::flush(){
+    writer->flush();
 }
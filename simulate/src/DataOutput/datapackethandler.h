@@ -11,6 +11,9 @@
 void makeDirectory(const std::string& path);
 
 class FileWrapper;
+class ChunkedFile;
+class AsyncWriter;
+class PacketPool;
 class SidePotentialLoading;
 class DataPacketHandler
 {
@@ -21,6 +24,11 @@ public:
     void dumpXYZ(const std::string& xyzstring);
     void dumpSnapshot(std::vector<DataPacket> packets, const std::string& xyz);
     bool doDumpXYZ(int timestep) const {return doWriteXYZ && timestep%freqXYZ == 0;};
+    // The data ids that will be written at the timestep. The packets are
+    // built in buffers from the pool of the handler
+    DataRequest due(int timestep) const;
+    // Blocks until all of the output handed over so far is written
+    void flush();
 
 private:
     void addBinary(DataPacket::dataId, const std::string &path);
@@ -29,9 +37,16 @@ private:
     std::shared_ptr<Parameters> parameters;
     std::map<DataPacket::dataId, std::unique_ptr<FileWrapper>> fileMap;
     std::map<DataPacket::dataId, std::unique_ptr<FileWrapper>> snapshotFiles;
+    // Replaces the files of fileMap when outputFormat is chunked
+    std::unique_ptr<ChunkedFile> chunkedFile;
+    // The period of every data id that is written
+    std::map<DataPacket::dataId, unsigned int> periods;
     bool doWriteXYZ;
     std::ofstream ofXYZ;
     unsigned int freqXYZ;
+    // All file output goes through the writer, in the order it is handed over
+    std::unique_ptr<AsyncWriter> writer;
+    std::shared_ptr<PacketPool>  pool;
 };
 
 
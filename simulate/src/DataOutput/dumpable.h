@@ -7,7 +7,7 @@ class Dumpable
 {
 public:
     Dumpable();
-    virtual std::vector<DataPacket> getDataPackets(int timestep, double time) = 0;
+    virtual std::vector<DataPacket> getDataPackets(int timestep, double time, const DataRequest &request) = 0;
 };
 
 #endif // DUMPABLE_H
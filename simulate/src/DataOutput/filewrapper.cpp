@@ -35,6 +35,9 @@ void FileWrapper::close(){
 }
 
 void FileWrapper::write(const DataPacket& packet){
-    if (is_open && packet.timestep() % period == 0 && good())
-        stream.write((char*)&packet.data()[0], packet.data().size()*sizeof(double));
+    if (is_open && packet.timestep() % period == 0 && good()){
+        const std::vector<double>& data = packet.data();
+        stream.write(reinterpret_cast<const char*>(data.data()),
+                     static_cast<std::streamsize>(data.size()*sizeof(double)));
+    }
 }
@@ -0,0 +1,52 @@
+#include "packetpool.h"
+
+PacketPool::PacketPool()
+{
+
+}
+
+std::shared_ptr<std::vector<double>> PacketPool::acquire(size_t capacity)
+{
+    std::unique_ptr<std::vector<double>> buffer;
+    {
+        // Take the smallest free buffer that is large enough, or else the largest
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_free.empty()){
+            size_t best = 0;
+            for (size_t i = 1; i < m_free.size(); i++){
+                const size_t have = m_free[i]->capacity();
+                const size_t bestHave = m_free[best]->capacity();
+                if (bestHave >= capacity ? (have >= capacity && have < bestHave) : have > bestHave)
+                    best = i;
+            }
+            buffer = std::move(m_free[best]);
+            m_free[best] = std::move(m_free.back());
+            m_free.pop_back();
+        }
+    }
+    if (!buffer)
+        buffer = std::unique_ptr<std::vector<double>>(new std::vector<double>());
+    buffer->clear();
+    buffer->reserve(capacity);
+
+    // The deleter hands the buffer back, unless the pool is gone
+    std::weak_ptr<PacketPool> pool = shared_from_this();
+    return std::shared_ptr<std::vector<double>>(buffer.release(), [pool](std::vector<double>* p){
+        if (auto owner = pool.lock())
+            owner->release(p);
+        else
+            delete p;
+    });
+}
+
+size_t PacketPool::numFree()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_free.size();
+}
+
+void PacketPool::release(std::vector<double>* buffer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(std::unique_ptr<std::vector<double>>(buffer));
+}
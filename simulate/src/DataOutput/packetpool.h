@@ -0,0 +1,31 @@
+#ifndef PACKETPOOL_H
+#define PACKETPOOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Recycles the buffers of DataPackets.
+// A buffer handed out by acquire() returns to the pool when the last packet
+// referring to it is destroyed, which may happen on the writer thread. After a
+// few timesteps every packet is built in a buffer that already has the
+// capacity it needs, so no memory is allocated while the simulation runs.
+class PacketPool : public std::enable_shared_from_this<PacketPool>
+{
+public:
+    PacketPool();
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    // Returns an empty buffer with room for at least capacity numbers
+    std::shared_ptr<std::vector<double>> acquire(size_t capacity);
+    size_t numFree();
+
+private:
+    void release(std::vector<double>* buffer);
+
+    std::mutex                                        m_mutex;
+    std::vector<std::unique_ptr<std::vector<double>>> m_free;
+};
+
+#endif /* PACKETPOOL_H */
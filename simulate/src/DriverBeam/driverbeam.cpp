@@ -16,7 +16,7 @@
 DriverBeam::DriverBeam(std::shared_ptr<Parameters>  parameters,
                        std::shared_ptr<Lattice>     lattice)
     :
-    Node(vec3(), 0, 0, lattice->latticeInfo),
+    Node(std::make_shared<NodeStore>(), vec3(), 0, 0, lattice->latticeInfo),
     m_lattice(lattice),
     m_parameters(parameters)
 {
@@ -39,13 +39,15 @@ void DriverBeam::attachToLattice(){
     stealTopNodes(m_lattice);
 
     // find the center of the beam
+    vec3 center = r();
     for (auto & node : m_nodes)
-        m_r += node->r();
-    m_r /= m_nodes.size();
+        center += node->r();
+    center /= m_nodes.size();
+    forcePosition(center);
 
     // store the default x-distance from the center for each node
     for (size_t i = 0; i < m_nodes.size(); i++){
-        m_distFromCenter.push_back(m_r[0]-m_nodes[i]->r()[0]);
+        m_distFromCenter.push_back(center[0]-m_nodes[i]->r()[0]);
         m_nodes[i]->setPhi(0.0);
     }
 }
@@ -68,72 +70,99 @@ void DriverBeam::stealTopNodes(std::shared_ptr<Lattice> lattice){
             else
                 ++it;
         }
+        // the beam imposes the position and velocity of the node
+        topnode->store()->setFlag(topnode->index(), NodeStore::CONSTRAINED, true);
         m_nodes.push_back(topnode);
     }
+    lattice->invalidateModifiers();
     // then, clear the topNodes (is this necessary??) YES!
     // lattice->topNodes.clear();
     // Sum the nodes3
+    double beamMass = mass();
     for (auto& node: m_nodes){
-        m_mass += node->mass();
+        beamMass += node->mass();
     }
-    m_mass += m_beamMass;
+    beamMass += m_beamMass;
+    setMass(beamMass);
     double d  = m_parameters->get<double>("d");
-    m_momentOfInertia = m_mass*d*m_nx*d*m_nx/12.0;
+    setMomentOfInertia(beamMass*d*m_nx*d*m_nx/12.0);
 }
 
 void DriverBeam::updateForcesAndMoments(){
-    m_moment = 0;
-    m_f      = 0;
+    double moment = 0;
+    vec3   force(0, 0, 0);
+    vec3   center = r();
 // #pragma omp parallel for
     for (size_t i = 0; i < m_nodes.size(); i++){
         m_nodes[i]->updateForcesAndMoments();
-        m_moment += -m_nodes[i]->f().cross2d(m_r-m_nodes[i]->r());
-        m_f      += m_nodes[i]->f();
+        moment += -m_nodes[i]->f().cross2d(center-m_nodes[i]->r());
+        force  += m_nodes[i]->f();
     }
-
+    setMoment(moment);
+    setForce(force);
 }
 
-void DriverBeam::vvstep(double dt){
+void DriverBeam::vvstep1(double dt){
     // m_omega += (m_moment/m_momentOfInertia)*0.5*dt;
     // m_phi   += m_omega*dt;
-    m_v     += (m_f/m_mass)*0.5*dt;
+    vec3   v   = this->v();
+    vec3   r   = this->r();
+    double phi = this->phi();
+    v     += (f()/mass())*0.5*dt;
 
     if (m_isDriving){
-        m_v[0] = correctVelocity();
-        m_phi  = m_angle;
+        v[0] = correctVelocity();
+        phi  = m_angle;
     }
     else
-        m_phi += m_phiStep;
+        phi += m_phiStep;
 
-    m_r   += m_v*dt;
+    r   += v*dt;
+    forceVelocity(v);
+    forcePosition(r);
+    setPhi(phi);
 
 // #pragma omp parallel for
     // Align the top nodes along the axis of the beam
     for (size_t i = 0; i < m_nodes.size(); i++){
         // m_nodes[i]->m_omega += (m_nodes[i]->m_moment/m_nodes[i]->m_momentOfInertia)*0.5*dt;
         // / m_nodes[i]->m_phi += m_nodes[i]->m_omega*dt;
-        m_nodes[i]->m_phi = m_phi;
+        m_nodes[i]->setPhi(phi);
 
-        vec3 r = m_r;
-        r[0] -= cos(m_phi)*m_distFromCenter[i];
-        r[1] += sin(m_phi)*m_distFromCenter[i];
-        m_nodes[i]->forcePosition(r);
-        m_nodes[i]->forceVelocity(m_v);
+        vec3 rNode = r;
+        rNode[0] -= cos(phi)*m_distFromCenter[i];
+        rNode[1] += sin(phi)*m_distFromCenter[i];
+        m_nodes[i]->forcePosition(rNode);
+        m_nodes[i]->forceVelocity(v);
     }
 }
 
-std::vector<DataPacket> DriverBeam::getDataPackets(int timestep, double time){
-    std::vector<DataPacket> packetvec = std::vector<DataPacket>();
+void DriverBeam::vvstep2(double dt){
+    // The driving velocity was set by vvstep1
+    vec3 v = this->v();
+    v[1] += (f()[1]/mass())*0.5*dt;
+    if (!m_isDriving)
+        v[0] += (f()[0]/mass())*0.5*dt;
+    forceVelocity(v);
+    for (size_t i = 0; i < m_nodes.size(); i++)
+        m_nodes[i]->forceVelocity(v);
+}
 
-    DataPacket torque     = DataPacket(DataPacket::dataId::BEAM_TORQUE, timestep, time);
-    DataPacket shearForce = DataPacket(DataPacket::dataId::BEAM_SHEAR_FORCE, timestep, time);
+std::vector<DataPacket> DriverBeam::getDataPackets(int timestep, double time, const DataRequest &request){
+    std::vector<DataPacket> packetvec = std::vector<DataPacket>();
 
-    for (std::shared_ptr<Node> node : m_nodes) {
-        torque.push_back(node->moment());
-        shearForce.push_back(node->f().x());
+    if (request.wants(DataPacket::dataId::BEAM_TORQUE)){
+        DataPacket torque = DataPacket(DataPacket::dataId::BEAM_TORQUE, timestep, time, request.buffer(m_nodes.size()));
+        for (const std::shared_ptr<Node> &node : m_nodes)
+            torque.push_back(node->moment());
+        packetvec.push_back(torque);
+    }
+    if (request.wants(DataPacket::dataId::BEAM_SHEAR_FORCE)){
+        DataPacket shearForce = DataPacket(DataPacket::dataId::BEAM_SHEAR_FORCE, timestep, time, request.buffer(m_nodes.size()));
+        for (const std::shared_ptr<Node> &node : m_nodes)
+            shearForce.push_back(node->f().x());
+        packetvec.push_back(shearForce);
     }
-    packetvec.push_back(torque);
-    packetvec.push_back(shearForce);
     return packetvec;
 }
 
@@ -147,7 +176,7 @@ double DriverBeam::correctVelocity(){
 }
 
 void DriverBeam::beginCorrectVelocity(){
-    m_initalVel = m_v[0];
+    m_initalVel = v()[0];
     m_velocityStep = (m_velocity-m_initalVel)/m_velocityTime;
 }
 
@@ -22,11 +22,12 @@ public :
     virtual ~DriverBeam();
 
     void attachToLattice();
-    std::vector<DataPacket> getDataPackets(int timestep, double time);
+    std::vector<DataPacket> getDataPackets(int timestep, double time, const DataRequest &request);
     void startDriving(){m_velocity = m_vD; m_isDriving=true;};
     void stealTopNodes(std::shared_ptr<Lattice>);
     void updateForcesAndMoments();
-    void vvstep(double dt);
+    void vvstep1(double dt);
+    void vvstep2(double dt);
     double correctVelocity();
     void beginCorrectVelocity();
     double totalShearForce();
@@ -8,6 +8,7 @@ class AbsoluteOmegaDamper: public ForceModifier
 public:
     AbsoluteOmegaDamper(double eta);
     double getMomentModification() override;
+    double eta() const {return m_eta;}
 protected:
     double m_eta = 0;
 };
@@ -1,4 +1,5 @@
 #include "constantforce.h"
+#include "Node/node.h"
 
 
 
@@ -11,3 +12,12 @@ ConstantForce::ConstantForce(vec3 force):
 vec3 ConstantForce::getForceModification(){
     return m_force;
 }
+
+void ConstantForce::initialize(){
+    m_origin = m_node->r();
+}
+
+double ConstantForce::potentialEnergy(){
+    vec3 r = m_node->r();
+    return -m_force[0]*(r[0] - m_origin[0]) - m_force[1]*(r[1] - m_origin[1]);
+}
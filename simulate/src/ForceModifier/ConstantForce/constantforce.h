@@ -9,6 +9,12 @@ public:
     ConstantForce(vec3 force);
 
     vec3 getForceModification() override;
+    void initialize() override;
+    // The work against the force since the node was where it was added
+    double potentialEnergy() override;
+    bool hasPotential() const override {return true;}
+    const vec3 & force() const {return m_force;}
 protected:
     vec3 m_force;
+    vec3 m_origin;
 };
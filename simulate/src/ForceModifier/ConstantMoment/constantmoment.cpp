@@ -1,4 +1,5 @@
 #include "constantmoment.h"
+#include "Node/node.h"
 
 
 ConstantMoment::ConstantMoment(double moment):
@@ -9,3 +10,11 @@ ConstantMoment::ConstantMoment(double moment):
 double ConstantMoment::getMomentModification(){
     return m_moment;
 }
+
+void ConstantMoment::initialize(){
+    m_origin = m_node->phi();
+}
+
+double ConstantMoment::potentialEnergy(){
+    return -m_moment*(m_node->phi() - m_origin);
+}
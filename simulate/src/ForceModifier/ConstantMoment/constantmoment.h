@@ -8,7 +8,13 @@ class ConstantMoment: public ForceModifier
 public:
     ConstantMoment(double moment);
     double getMomentModification() override;
+    void initialize() override;
+    // The work against the moment since the node was where it was added
+    double potentialEnergy() override;
+    bool hasPotential() const override {return true;}
+    double moment() const {return m_moment;}
 protected:
     double m_moment = 0;
+    double m_origin = 0;
 };
 
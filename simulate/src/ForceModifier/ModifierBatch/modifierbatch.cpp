@@ -0,0 +1,186 @@
+#include <typeinfo>
+#include "modifierbatch.h"
+#include "BondList/bondlist.h"
+#include "ForceModifier/forcemodifier.h"
+#include "ForceModifier/RelativeVelocityDamper/relativevelocitydamper.h"
+#include "ForceModifier/AbsoluteOmegaDamper/absoluteomegadamper.h"
+#include "ForceModifier/ConstantForce/constantforce.h"
+#include "ForceModifier/ConstantMoment/constantmoment.h"
+#include "ForceModifier/PotentialSurface/potentialsurface.h"
+#include "ForceModifier/SpringFriction/springfriction.h"
+#include "SpringStore/springstore.h"
+
+template<typename T, typename ...Args>
+std::unique_ptr<T> make_unique( Args&& ...args )
+{
+    return std::unique_ptr<T>( new T( std::forward<Args>(args)... ) );
+}
+
+std::unique_ptr<ModifierBatch> ModifierBatch::create(const ForceModifier &modifier)
+{
+    // Subclasses of the batched modifiers may change what they do, so only
+    // the exact types are batched
+    const std::type_info &type = typeid(modifier);
+    if (type == typeid(RelativeVelocityDamper))
+        return make_unique<RelativeVelocityDamperBatch>();
+    else if (type == typeid(AbsoluteOmegaDamper))
+        return make_unique<AbsoluteOmegaDamperBatch>();
+    else if (type == typeid(ConstantForce))
+        return make_unique<ConstantForceBatch>();
+    else if (type == typeid(ConstantMoment))
+        return make_unique<ConstantMomentBatch>();
+    else if (type == typeid(PotentialSurface))
+        return make_unique<PotentialSurfaceBatch>();
+    else if (type == typeid(SpringFriction))
+        return make_unique<SpringFrictionBatch>();
+    else
+        return make_unique<GenericBatch>();
+}
+
+bool ModifierBatch::accepts(size_t, const ForceModifier &, const BondList &, size_t) const
+{
+    return true;
+}
+
+bool RelativeVelocityDamperBatch::accepts(size_t index, const ForceModifier &,
+                                          const BondList &bonds, size_t numNeighbors) const
+{
+    return index+1 < bonds.offsets.size() && bonds.numBonds(index) == numNeighbors;
+}
+
+void RelativeVelocityDamperBatch::add(size_t index, const std::shared_ptr<ForceModifier> &modifier)
+{
+    m_index.push_back(index);
+    m_eta.push_back(static_cast<const RelativeVelocityDamper&>(*modifier).eta());
+}
+
+void RelativeVelocityDamperBatch::apply(NodeStore &store, const BondList &bonds, double)
+{
+#pragma omp for schedule(runtime)
+    for (size_t n = 0; n < m_index.size(); n++){
+        const size_t i = m_index[n];
+        double dampX = 0;
+        double dampY = 0;
+        sum(store, bonds, i, m_eta[n], dampX, dampY);
+        store.fx[i] += dampX;
+        store.fy[i] += dampY;
+    }
+}
+
+void RelativeVelocityDamperBatch::sum(const NodeStore &store, const BondList &bonds, size_t i, double eta,
+                                      double &dampX, double &dampY)
+{
+    // The neighbors are those of the bond list, in the order of the
+    // neighbor information of the node
+    for (size_t b = bonds.offsets[i]; b < bonds.offsets[i+1]; b++){
+        const size_t j = bonds.neighbor[b];
+        dampX += eta*(store.vx[j] - store.vx[i]);
+        dampY += eta*(store.vy[j] - store.vy[i]);
+    }
+}
+
+void AbsoluteOmegaDamperBatch::add(size_t index, const std::shared_ptr<ForceModifier> &modifier)
+{
+    m_index.push_back(index);
+    m_eta.push_back(static_cast<const AbsoluteOmegaDamper&>(*modifier).eta());
+}
+
+void AbsoluteOmegaDamperBatch::apply(NodeStore &store, const BondList &, double)
+{
+#pragma omp for schedule(runtime)
+    for (size_t n = 0; n < m_index.size(); n++){
+        const size_t i = m_index[n];
+        store.moment[i] += -m_eta[n]*store.omega[i];
+    }
+}
+
+void ConstantForceBatch::add(size_t index, const std::shared_ptr<ForceModifier> &modifier)
+{
+    const vec3 & force = static_cast<const ConstantForce&>(*modifier).force();
+    m_index.push_back(index);
+    m_fx.push_back(force.components[0]);
+    m_fy.push_back(force.components[1]);
+}
+
+void ConstantForceBatch::apply(NodeStore &store, const BondList &, double)
+{
+#pragma omp for schedule(runtime)
+    for (size_t n = 0; n < m_index.size(); n++){
+        const size_t i = m_index[n];
+        store.fx[i] += m_fx[n];
+        store.fy[i] += m_fy[n];
+    }
+}
+
+void ConstantMomentBatch::add(size_t index, const std::shared_ptr<ForceModifier> &modifier)
+{
+    m_index.push_back(index);
+    m_moment.push_back(static_cast<const ConstantMoment&>(*modifier).moment());
+}
+
+void ConstantMomentBatch::apply(NodeStore &store, const BondList &, double)
+{
+#pragma omp for schedule(runtime)
+    for (size_t n = 0; n < m_index.size(); n++)
+        store.moment[m_index[n]] += m_moment[n];
+}
+
+void PotentialSurfaceBatch::add(size_t index, const std::shared_ptr<ForceModifier> &modifier)
+{
+    m_index.push_back(index);
+    m_k.push_back(static_cast<const PotentialSurface&>(*modifier).k());
+}
+
+void PotentialSurfaceBatch::apply(NodeStore &store, const BondList &, double)
+{
+#pragma omp for schedule(runtime)
+    for (size_t n = 0; n < m_index.size(); n++){
+        const size_t i = m_index[n];
+        const double y = store.y[i];
+        store.fy[i] += y < 0 ? -m_k[n]*y : 0.0;
+    }
+}
+
+bool SpringFrictionBatch::accepts(size_t, const ForceModifier &modifier, const BondList &, size_t) const
+{
+    return !m_springs || static_cast<const SpringFriction&>(modifier).springs() == m_springs;
+}
+
+void SpringFrictionBatch::add(size_t index, const std::shared_ptr<ForceModifier> &modifier)
+{
+    const SpringFriction &springFriction = static_cast<const SpringFriction&>(*modifier);
+    m_springs = springFriction.springs();
+    m_index.push_back(index);
+    m_element.push_back(springFriction.element());
+}
+
+void SpringFrictionBatch::apply(NodeStore &store, const BondList &, double t)
+{
+    // The springs of each element are updated in vector lanes
+    SpringStore &springs = *m_springs;
+#pragma omp for schedule(runtime)
+    for (size_t n = 0; n < m_index.size(); n++){
+        const size_t i   = m_index[n];
+        const vec3 force = springs.update(m_element[n], store.x[i], store.y[i], t);
+        store.fx[i] += force.components[0];
+        store.fy[i] += force.components[1];
+    }
+}
+
+void GenericBatch::add(size_t index, const std::shared_ptr<ForceModifier> &modifier)
+{
+    m_index.push_back(index);
+    m_modifiers.push_back(modifier);
+}
+
+void GenericBatch::apply(NodeStore &store, const BondList &, double)
+{
+#pragma omp for schedule(runtime)
+    for (size_t n = 0; n < m_index.size(); n++){
+        const size_t i = m_index[n];
+        const vec3 force = m_modifiers[n]->getForceModification();
+        store.fx[i]     += force.components[0];
+        store.fy[i]     += force.components[1];
+        store.moment[i] += m_modifiers[n]->getMomentModification();
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "NodeStore/nodestore.h"
+
+class ForceModifier;
+class BondList;
+class SpringStore;
+
+// The force modifiers of one type over the whole lattice.
+// Instead of every node calling its own modifiers, the lattice hands each
+// modifier to the batch of its type, which keeps the indices of the nodes and
+// the parameters of the modifiers in flat arrays and applies all of them in
+// one loop over the store. The SpringFriction batch updates the springs of
+// all of its elements in their SpringStore. Modifiers without a batch of
+// their own are kept in a generic batch which calls them one by one.
+//
+// A batch adds to the forces and moments already in the store, with the
+// same operations and in the same order as the modifier itself, so the
+// result does not change when a modifier is batched. The modifiers do their
+// arithmetic through the vec3 operators, which round every product on its
+// own, so this file is compiled without contracting to fused multiply-adds.
+//
+// The interface forces, the friction springs and the potential of the
+// surface, are much stiffer than the beams. Their batches are fast, and the
+// lattice may apply them several times per step, see Lattice::parallelStep.
+class ModifierBatch
+{
+public:
+    virtual ~ModifierBatch() = default;
+    // A batch for modifiers of the same type as modifier
+    static std::unique_ptr<ModifierBatch> create(const ForceModifier &modifier);
+
+    // Whether the modifier of the node at index can be batched. The relative
+    // velocity damper needs the bonds of the node to be its neighbors
+    virtual bool accepts(size_t index, const ForceModifier &modifier,
+                         const BondList &bonds, size_t numNeighbors) const;
+    virtual void add(size_t index, const std::shared_ptr<ForceModifier> &modifier) = 0;
+    // Applies the modifiers at time t. The work is shared by the threads of
+    // the enclosing parallel region, so every thread of the region must call it
+    virtual void apply(NodeStore &store, const BondList &bonds, double t) = 0;
+    // Whether the modifiers are fast interface forces. Fast batches only add
+    // to the force of a node, not its moment
+    virtual bool isFast() const {return false;}
+    size_t size() const {return m_index.size();}
+    const std::vector<size_t>& indices() const {return m_index;}
+
+protected:
+    std::vector<size_t> m_index;
+};
+
+class RelativeVelocityDamperBatch : public ModifierBatch
+{
+public:
+    bool accepts(size_t index, const ForceModifier &modifier,
+                 const BondList &bonds, size_t numNeighbors) const override;
+    void add(size_t index, const std::shared_ptr<ForceModifier> &modifier) override;
+    void apply(NodeStore &store, const BondList &bonds, double t) override;
+    // Adds the damping of node i by the neighbors of its bonds to dampX and
+    // dampY, rounded as by the damper. Also used by the beam kernels of
+    // BondList for the dampers fused into them
+    static void sum(const NodeStore &store, const BondList &bonds, size_t i, double eta,
+                    double &dampX, double &dampY);
+private:
+    std::vector<double> m_eta;
+};
+
+class AbsoluteOmegaDamperBatch : public ModifierBatch
+{
+public:
+    void add(size_t index, const std::shared_ptr<ForceModifier> &modifier) override;
+    void apply(NodeStore &store, const BondList &bonds, double t) override;
+private:
+    std::vector<double> m_eta;
+};
+
+class ConstantForceBatch : public ModifierBatch
+{
+public:
+    void add(size_t index, const std::shared_ptr<ForceModifier> &modifier) override;
+    void apply(NodeStore &store, const BondList &bonds, double t) override;
+private:
+    std::vector<double> m_fx;
+    std::vector<double> m_fy;
+};
+
+class ConstantMomentBatch : public ModifierBatch
+{
+public:
+    void add(size_t index, const std::shared_ptr<ForceModifier> &modifier) override;
+    void apply(NodeStore &store, const BondList &bonds, double t) override;
+private:
+    std::vector<double> m_moment;
+};
+
+class PotentialSurfaceBatch : public ModifierBatch
+{
+public:
+    void add(size_t index, const std::shared_ptr<ForceModifier> &modifier) override;
+    void apply(NodeStore &store, const BondList &bonds, double t) override;
+    bool isFast() const override {return true;}
+private:
+    std::vector<double> m_k;
+};
+
+// All of the elements must share one SpringStore
+class SpringFrictionBatch : public ModifierBatch
+{
+public:
+    bool accepts(size_t index, const ForceModifier &modifier,
+                 const BondList &bonds, size_t numNeighbors) const override;
+    void add(size_t index, const std::shared_ptr<ForceModifier> &modifier) override;
+    void apply(NodeStore &store, const BondList &bonds, double t) override;
+    bool isFast() const override {return true;}
+private:
+    std::shared_ptr<SpringStore> m_springs;
+    std::vector<size_t>          m_element;
+};
+
+// Calls the modifiers through their virtual functions
+class GenericBatch : public ModifierBatch
+{
+public:
+    void add(size_t index, const std::shared_ptr<ForceModifier> &modifier) override;
+    void apply(NodeStore &store, const BondList &bonds, double t) override;
+private:
+    std::vector<std::shared_ptr<ForceModifier>> m_modifiers;
+};
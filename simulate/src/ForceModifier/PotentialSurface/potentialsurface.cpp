@@ -16,3 +16,8 @@ vec3 PotentialSurface::getForceModification(){
         return vec3(0,0,0);
     }
 }
+
+double PotentialSurface::potentialEnergy(){
+    vec3 r = m_node->r();
+    return r[1] < 0 ? 0.5*m_k*r[1]*r[1] : 0.0;
+}
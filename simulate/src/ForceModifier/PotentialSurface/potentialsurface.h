@@ -10,6 +10,9 @@ class PotentialSurface : public ForceModifier
 public:
     PotentialSurface(double k);
     vec3 getForceModification() override;
+    double potentialEnergy() override;
+    bool hasPotential() const override {return true;}
+    double k() const {return m_k;}
 protected:
     double m_k = 0;
 };
@@ -8,6 +8,7 @@ class RelativeVelocityDamper: public ForceModifier
 public:
     RelativeVelocityDamper(double eta);
     vec3 getForceModification() override;
+    double eta() const {return m_eta;}
 protected:
     double m_eta = 0;
 };
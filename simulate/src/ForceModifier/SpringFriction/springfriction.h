@@ -1,40 +1,36 @@
 #pragma once
 
-#include <vector>
+#include <memory>
 #include "ForceModifier/forcemodifier.h"
 #include "FrictionInfo/frictioninfo.h"
-#include "DataOutput/dumpable.h"
-#include <random>
+#include "SpringStore/springstore.h"
 
 
+// The micro-springs between an interface node and the surface below. The
+// springs live in a SpringStore shared by all of the friction elements,
+// which the lattice updates for all elements at once when the modifiers are
+// batched
 class SpringFriction : public ForceModifier
 {
 public:
-    SpringFriction(std::shared_ptr<FrictionInfo>);
+    SpringFriction(std::shared_ptr<FrictionInfo>, std::shared_ptr<SpringStore>);
 
     void initialize();
     vec3 getForceModification();
+    // The elastic energy of the springs less their energyGain, see SpringStore
+    double potentialEnergy() override;
+    bool hasPotential() const override {return true;}
 
-
-    std::vector<double> m_x0; // Acual position of node connection point
-    std::vector<double> m_xOffset; // Offset from node center position
-    std::vector<double> m_tReattach;
-    std::vector<bool>   m_isConnected;
-    std::vector<double> m_k;
-    std::vector<double> m_fs;
-    std::vector<double> m_fk;
-    double              m_meantime;
-    double              m_stdtime;
-    int                 m_ns;
-    double              m_fnAvg;
-    double              m_kNormal;
-    bool                isLockSprings = false;
-    double              m_numSpringsAttached = 0;
-    double              m_normalForce = 0;
-    double              m_shearForce = 0;
-
-    static std::random_device rd;
-    static thread_local std::mt19937 gen;
+    void   setLockSprings(bool isLocked) {m_springs->setLocked(m_element, isLocked);}
+    double numSpringsAttached() const {return m_springs->numAttached[m_element];}
+    double normalForce()        const {return m_springs->normalForce[m_element];}
+    double shearForce()         const {return m_springs->shearForce[m_element];}
+    size_t element()            const {return m_element;}
+    const std::shared_ptr<SpringStore> & springs() const {return m_springs;}
 
     std::shared_ptr<FrictionInfo> m_frictionInfo;
+
+private:
+    std::shared_ptr<SpringStore> m_springs;
+    size_t                       m_element = 0;
 };
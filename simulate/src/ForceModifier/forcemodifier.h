@@ -13,6 +13,12 @@ public:
     virtual double getMomentModification() {return 0;}
     virtual void setNode(std::shared_ptr<Node> node) {m_node = node;}
     virtual void initialize() {;}
+    // For the energy balance of the lattice, see Lattice::addWork. When the
+    // force has a potential, hasPotential is true and potentialEnergy gives
+    // it at the node, less any energy the modifier took in other than by
+    // its force. The force of the other modifiers does work on the node
+    virtual double potentialEnergy() {return 0;}
+    virtual bool hasPotential() const {return false;}
     //virtual void fileOutputAction(std::shared_ptr<H5::H5File>) {;}
 
 protected:
@@ -49,7 +49,7 @@ SidePotentialLoading::SidePotentialLoading(std::shared_ptr<Parameters> parameter
     // Add springs
     for (auto & node : m_lattice->bottomNodes)
     {
-        std::shared_ptr<SpringFriction> springFriction = std::make_shared<SpringFriction>(frictionInfo);
+        std::shared_ptr<SpringFriction> springFriction = std::make_shared<SpringFriction>(frictionInfo, springs);
         frictionElements.push_back(springFriction);
         node->addModifier(std::move(springFriction));
     }
@@ -76,6 +76,8 @@ SidePotentialLoading::SidePotentialLoading(std::shared_ptr<Parameters> parameter
     dumper.dumpFrictionInfo(frictionInfo);
     dumper.dumpParameters(parameters);
     dumper.dumpLatticeStructure(m_lattice);
+    if (parameters->get<bool>("writeLatticeBinary"))
+        dumper.dumpLatticeBinary(m_lattice, parameters);
 }
 
 SidePotentialLoading::~SidePotentialLoading()
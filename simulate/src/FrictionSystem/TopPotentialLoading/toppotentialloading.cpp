@@ -52,7 +52,7 @@ TopPotentialLoading::TopPotentialLoading(std::shared_ptr<Parameters> parameters)
     // Add springs
     for (auto & node : m_lattice->bottomNodes)
     {
-        std::shared_ptr<SpringFriction> springFriction = std::make_shared<SpringFriction>(frictionInfo);
+        std::shared_ptr<SpringFriction> springFriction = std::make_shared<SpringFriction>(frictionInfo, springs);
         frictionElements.push_back(springFriction);
         node->addModifier(std::move(springFriction));
     }
@@ -81,11 +81,13 @@ TopPotentialLoading::TopPotentialLoading(std::shared_ptr<Parameters> parameters)
     dumper.dumpFrictionInfo(frictionInfo);
     dumper.dumpParameters(parameters);
     dumper.dumpLatticeStructure(m_lattice);
+    if (parameters->get<bool>("writeLatticeBinary"))
+        dumper.dumpLatticeBinary(m_lattice, parameters);
 
     // Add the driver
     m_driverBeam = std::make_shared<DriverBeam>(m_parameters, m_lattice);
     m_driverBeam->attachToLattice();
-    m_lattice->nodes.push_back(m_driverBeam);
+    m_lattice->addExternalNode(m_driverBeam);
 
     // And add dampning
     std::unique_ptr<RelativeVelocityDamper> damper = make_unique<RelativeVelocityDamper>(eta);
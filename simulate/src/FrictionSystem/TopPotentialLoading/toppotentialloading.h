@@ -15,7 +15,7 @@ public:
     double totalDriverForce()         const override {return -m_driverBeam->totalShearForce();}
     size_t numberOfNodes()            const override;
     void   startDriving(double tInit)       override;
-    std::vector<DataPacket> getDriverPackets(int timestep, double time) const override {return m_driverBeam->getDataPackets(timestep, time);};
+    std::vector<DataPacket> getDriverPackets(int timestep, double time, const DataRequest &request) const override {return m_driverBeam->getDataPackets(timestep, time, request);};
     std::shared_ptr<DriverBeam> m_driverBeam;
 };
 
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <cmath>
 #include "ForceModifier/ConstantForce/constantforce.h"
 #include "ForceModifier/PotentialSurface/potentialsurface.h"
@@ -27,7 +29,16 @@ FrictionSystem::FrictionSystem(std::shared_ptr<Parameters> parameters) {
     m_vD                   = parameters->get<double>("vD");
     m_snapshotBeginTime    = parameters->get<int>("snapshotstart");
     m_snapshotBufferTime   = parameters->get<int>("snapshotbuftime");
+    m_rotationCheckPeriod  = parameters->get<int>("bondRotationCheck");
+    m_rotationTolerance    = parameters->get<double>("bondRotationTolerance");
+    m_energyCheckPeriod    = parameters->get<int>("energyCheck");
     m_dataHandler = make_unique<DataPacketHandler>(parameters->get<std::string>("outputpath"), parameters);
+    const int seed = parameters->get<int>("randomSeed");
+    if (seed < 0)
+        throw std::runtime_error("randomSeed must be non-negative");
+    springs       = std::make_shared<SpringStore>(static_cast<uint64_t>(seed));
+    if (m_energyCheckPeriod > 0)
+        springs->trackEnergy();
 }
 
 FrictionSystem::~FrictionSystem(){};
@@ -35,15 +46,65 @@ FrictionSystem::~FrictionSystem(){};
 void FrictionSystem::isLockFrictionSprings(bool isLock)
 {
     for (auto & frictionElement : frictionElements)
-        frictionElement->isLockSprings = isLock;
+        frictionElement->setLockSprings(isLock);
 }
 
 void FrictionSystem::step(double step, unsigned int timestep){
     m_lattice->step(step);
-    m_currentPackets = getDataPackets(timestep, timestep*step);
+    checkBondRotation(timestep);
+    countWork(timestep);
+    // The velocities are only brought up to date when they are written
+    if (prepareOutput(timestep))
+        m_lattice->synchronize();
+    checkEnergy(timestep);
+    writeOutput(step, timestep);
+}
+
+void FrictionSystem::parallelStep(double step, unsigned int timestep, std::exception_ptr &error){
+    m_lattice->parallelStep(step);
+#pragma omp master
+    {
+        try {
+            checkBondRotation(timestep);
+            countWork(timestep);
+            m_doSynchronize = prepareOutput(timestep);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+#pragma omp barrier
+    if (m_doSynchronize)
+        m_lattice->parallelSynchronize();
+#pragma omp master
+    {
+        try {
+            if (!error){
+                checkEnergy(timestep);
+                writeOutput(step, timestep);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+}
+
+bool FrictionSystem::prepareOutput(unsigned int timestep){
+    // Only gather the data that is written this timestep, unless all of it
+    // may be needed for a snapshot
+    m_request = m_dataHandler->due(timestep);
+    if (isSnapshotCandidate(timestep))
+        m_request.addAll();
+    m_doDumpXYZ = m_dataHandler->doDumpXYZ(timestep);
+    const bool checksEnergy = m_energyCheckPeriod > 0 && timestep % m_energyCheckPeriod == 0;
+    return m_request.any() || m_doDumpXYZ || checksEnergy;
+}
+
+void FrictionSystem::writeOutput(double step, unsigned int timestep){
+    m_contactEvents = springs->takeContactEvents();
+    m_currentPackets = getDataPackets(timestep, timestep*step, m_request);
     m_dataHandler->step(m_currentPackets);
 
-    if(m_dataHandler->doDumpXYZ(timestep)){
+    if(m_doDumpXYZ){
         // xyzString() is an expensive function, so it will
         // only be run if necessary
         m_dataHandler->dumpXYZ(xyzString(step*timestep));
@@ -52,6 +113,73 @@ void FrictionSystem::step(double step, unsigned int timestep){
         m_dataHandler->dumpSnapshot(m_snapshotPackets, m_snapshotxyz);
 }
 
+void FrictionSystem::checkBondRotation(unsigned int timestep){
+    if (m_rotationCheckPeriod == 0 || timestep % m_rotationCheckPeriod != 0
+        || m_lattice->bonds->rotation() != BondList::Rotation::SMALL_ANGLE)
+        return;
+    const double error = m_lattice->bonds->rotationError(*m_lattice->store);
+    m_maxRotationError = std::max(m_maxRotationError, error);
+    m_numRotationChecks++;
+    if (error > m_rotationTolerance){
+        std::stringstream message;
+        message << "The small angle rotation of the beams is off by " << error
+                << " rad at timestep " << timestep;
+        throw std::runtime_error(message.str());
+    }
+}
+
+void FrictionSystem::reportBondRotation() const{
+    if (m_numRotationChecks > 0)
+        std::cout << "The small angle rotation of the beams was off by at most " << m_maxRotationError
+                  << " rad in " << m_numRotationChecks << " checks" << std::endl;
+}
+
+void FrictionSystem::countWork(unsigned int timestep){
+    // The work is counted from the first check on
+    if (m_countsWork)
+        m_lattice->addWork();
+    else if (m_energyCheckPeriod > 0 && timestep % m_energyCheckPeriod == 0){
+        m_lattice->beginWork();
+        m_countsWork = true;
+    }
+}
+
+void FrictionSystem::checkEnergy(unsigned int timestep){
+    if (m_energyCheckPeriod == 0 || timestep % m_energyCheckPeriod != 0)
+        return;
+    // Damping, driving, the driver beam and the sliding springs change the
+    // energy by the work they do, which is taken out
+    const double kinetic   = m_lattice->kineticEnergy();
+    const double potential = m_lattice->potentialEnergy();
+    m_lastEnergy  = kinetic + potential - m_lattice->work();
+    m_energyScale = std::max(m_energyScale, std::max(kinetic, std::fabs(potential)));
+    if (m_numEnergyChecks == 0)
+        m_firstEnergy = m_lastEnergy;
+    m_maxEnergyDrift = std::max(m_maxEnergyDrift, std::fabs(m_lastEnergy - m_firstEnergy));
+    m_numEnergyChecks++;
+}
+
+void FrictionSystem::reportEnergy() const{
+    if (m_numEnergyChecks == 0)
+        return;
+    // The total energy may be near zero, so the drift is compared to the
+    // energy that changed hands between the kinetic and potential forms
+    const double scale = m_energyScale;
+    std::cout << "The energy of the lattice, less the work done on it, went from " << m_firstEnergy << " J to " << m_lastEnergy
+              << " J in " << m_numEnergyChecks << " checks, a drift of " << m_lastEnergy - m_firstEnergy
+              << " J (" << (scale > 0 ? (m_lastEnergy - m_firstEnergy)/scale : 0.0)
+              << " of the largest kinetic or potential energy), and was at most " << m_maxEnergyDrift
+              << " J from the start" << std::endl;
+}
+
+void FrictionSystem::flushOutput(){
+    m_dataHandler->flush();
+}
+
+bool FrictionSystem::isSnapshotCandidate(unsigned int timestep) const{
+    return timestep >= m_snapshotBeginTime && totalDriverForce() > m_maxRecordedDriveForce;
+}
+
 bool FrictionSystem::doDumpSnapshot(double step, unsigned int timestep){
     if(timestep < m_snapshotBeginTime)
         return false;
@@ -70,36 +198,54 @@ bool FrictionSystem::doDumpSnapshot(double step, unsigned int timestep){
         return false;
 }
 
-std::vector<DataPacket> FrictionSystem::getDataPackets(int timestep, double time)
+std::vector<DataPacket> FrictionSystem::getDataPackets(int timestep, double time, const DataRequest &request)
 {
     // Get the data packets from the lattice
-    std::vector<DataPacket> packets = m_lattice->getDataPackets(timestep, time);
+    std::vector<DataPacket> packets = m_lattice->getDataPackets(timestep, time, request);
 
     // Get the data from the friction elements
-    DataPacket attachedSprings = DataPacket(DataPacket::dataId::INTERFACE_ATTACHED_SPRINGS, timestep, time);
-    DataPacket normalForce     = DataPacket(DataPacket::dataId::INTERFACE_NORMAL_FORCE, timestep, time);
-    DataPacket shearForce      = DataPacket(DataPacket::dataId::INTERFACE_SHEAR_FORCE, timestep, time);
-    for (auto & frictionElement : frictionElements) {
-        attachedSprings.push_back(frictionElement->m_numSpringsAttached);
-        normalForce.push_back(frictionElement->m_normalForce);
-        shearForce.push_back(frictionElement->m_shearForce);
+    const size_t numElements = frictionElements.size();
+    if (request.wants(DataPacket::dataId::INTERFACE_ATTACHED_SPRINGS)){
+        DataPacket attachedSprings = DataPacket(DataPacket::dataId::INTERFACE_ATTACHED_SPRINGS, timestep, time, request.buffer(numElements));
+        for (auto & frictionElement : frictionElements)
+            attachedSprings.push_back(frictionElement->numSpringsAttached());
+        packets.push_back(attachedSprings);
+    }
+    if (request.wants(DataPacket::dataId::INTERFACE_NORMAL_FORCE)){
+        DataPacket normalForce = DataPacket(DataPacket::dataId::INTERFACE_NORMAL_FORCE, timestep, time, request.buffer(numElements));
+        for (auto & frictionElement : frictionElements)
+            normalForce.push_back(frictionElement->normalForce());
+        packets.push_back(normalForce);
+    }
+    if (request.wants(DataPacket::dataId::INTERFACE_SHEAR_FORCE)){
+        DataPacket shearForce = DataPacket(DataPacket::dataId::INTERFACE_SHEAR_FORCE, timestep, time, request.buffer(numElements));
+        for (auto & frictionElement : frictionElements)
+            shearForce.push_back(frictionElement->shearForce());
+        packets.push_back(shearForce);
+    }
+    if (request.wants(DataPacket::dataId::INTERFACE_CONTACT_EVENTS)){
+        DataPacket contactEvents = DataPacket(DataPacket::dataId::INTERFACE_CONTACT_EVENTS, timestep, time, request.buffer(2));
+        const auto touchdowns = std::count_if(m_contactEvents.begin(), m_contactEvents.end(),
+                                              [](const SpringStore::ContactEvent &event){return event.touchdown;});
+        contactEvents.push_back(static_cast<double>(touchdowns));
+        contactEvents.push_back(static_cast<double>(m_contactEvents.size())-static_cast<double>(touchdowns));
+        packets.push_back(contactEvents);
     }
-    packets.push_back(attachedSprings);
-    packets.push_back(normalForce);
-    packets.push_back(shearForce);
 
     // Get the data packets from the pusher nodes
-    double pushForce = 0;
-    for (auto & pusherNode : pusherNodes){
-        pushForce += pusherNode->fPush;
-    }
-    DataPacket pusherForce = DataPacket(DataPacket::dataId::PUSHER_FORCE, timestep, time);
+    if (request.wants(DataPacket::dataId::PUSHER_FORCE)){
+        double pushForce = 0;
+        for (auto & pusherNode : pusherNodes){
+            pushForce += pusherNode->fPush;
+        }
+        DataPacket pusherForce = DataPacket(DataPacket::dataId::PUSHER_FORCE, timestep, time, request.buffer(1));
 
-    pusherForce.push_back(pushForce);
-    packets.push_back(pusherForce);
+        pusherForce.push_back(pushForce);
+        packets.push_back(pusherForce);
+    }
 
     // Get the data packets from the driver
-    auto driverPackets = getDriverPackets(timestep, time);
+    auto driverPackets = getDriverPackets(timestep, time, request);
     packets.insert(packets.end(), driverPackets.begin(), driverPackets.end());
     return packets;
 }
@@ -135,9 +281,11 @@ size_t FrictionSystem::numberOfNodes() const {
         + m_driverNodes.size();
 }
 
-std::vector<DataPacket> FrictionSystem::getDriverPackets(int timestep, double time) const{
+std::vector<DataPacket> FrictionSystem::getDriverPackets(int timestep, double time, const DataRequest &request) const{
     std::vector<DataPacket> packetVec = std::vector<DataPacket>();
-    DataPacket pusherForce = DataPacket(DataPacket::dataId::BEAM_SHEAR_FORCE, timestep, time);
+    if (!request.wants(DataPacket::dataId::BEAM_SHEAR_FORCE))
+        return packetVec;
+    DataPacket pusherForce = DataPacket(DataPacket::dataId::BEAM_SHEAR_FORCE, timestep, time, request.buffer(1));
     double pusherforce = 0;
     for(auto & node: m_driverNodes){
         pusherforce += node->f().x();
@@ -2,6 +2,7 @@
 #define FRICTIONSYSTEM_H
 
 
+#include <exception>
 #include <memory.h>
 #include <vector>
 #include <fstream>
@@ -10,6 +11,7 @@
 #include "DataOutput/datapackethandler.h"
 #include "DataOutput/dumpable.h"
 #include "Lattice/lattice.h"
+#include "SpringStore/springstore.h"
 
 class SpringFriction;
 class PotentialPusher;
@@ -25,15 +27,43 @@ public:
     virtual void        startDriving(double tInit) = 0;
     virtual void        isLockFrictionSprings(bool);
     virtual void        step(double step, unsigned int timestep);
+            // As step, but run by every thread of an enclosing parallel
+            // region. The output is written by the master thread, and an
+            // exception it throws is stored in error
+            void        parallelStep(double step, unsigned int timestep, std::exception_ptr &error);
     virtual size_t      numberOfNodes() const;
     virtual double      totalDriverForce() const;
     virtual void        postProcessing(){};
+            // Waits until all output is written to disk
+            void        flushOutput();
             bool        doDumpSnapshot(double step, unsigned int timestep);
-    virtual std::vector<DataPacket> getDataPackets(int timestep, double time) override;
+            // True if the timestep sets a new maximum of the driver force,
+            // in which case the packets are kept for the snapshot
+            bool        isSnapshotCandidate(unsigned int timestep) const;
+    virtual std::vector<DataPacket> getDataPackets(int timestep, double time, const DataRequest &request) override;
     virtual std::string xyzString(double time) const;
-    virtual std::vector<DataPacket> getDriverPackets(int timestep, double time) const;
+    virtual std::vector<DataPacket> getDriverPackets(int timestep, double time, const DataRequest &request) const;
+            // Decides what is written at the timestep. True if the velocities
+            // must be synchronized first
+            bool        prepareOutput(unsigned int timestep);
+            void        writeOutput(double step, unsigned int timestep);
+            // Compares the small angle rotation of the beams to atan2 every
+            // bondRotationCheck timesteps, and throws if they differ by more
+            // than bondRotationTolerance
+            void        checkBondRotation(unsigned int timestep);
+            void        reportBondRotation() const;
+            // Sums the energy of the lattice less the work done on it every
+            // energyCheck timesteps, to report how much it drifted. countWork
+            // adds up the work, and must be called after every step before
+            // the velocities are synchronized
+            void        countWork(unsigned int timestep);
+            void        checkEnergy(unsigned int timestep);
+            void        reportEnergy() const;
+            // The touchdowns and liftoffs of the friction elements in the last timestep
+            const std::vector<SpringStore::ContactEvent>& contactEvents() const {return m_contactEvents;}
 
     std::vector<std::shared_ptr<SpringFriction>>  frictionElements;
+    std::shared_ptr<SpringStore>                  springs; // The springs of the friction elements
     std::vector<std::shared_ptr<PotentialPusher>> pusherNodes;
     std::vector<std::shared_ptr<Node>>            m_driverNodes;
     std::shared_ptr<Lattice>                      m_lattice;
@@ -50,6 +80,7 @@ protected:
     double                             m_k;
     double                             m_maxRecordedDriveForce = 0;
     std::vector<DataPacket>            m_currentPackets;
+    std::vector<SpringStore::ContactEvent> m_contactEvents;
     std::vector<DataPacket>            m_snapshotPackets;
     std::string                        m_snapshotxyz;
     unsigned int                       m_snapshotBufferTime = 1;
@@ -57,6 +88,20 @@ protected:
     std::unique_ptr<DataPacketHandler> m_dataHandler;
     bool                               m_newMaximum = false;
     bool                               m_isDriving = false;
+    DataRequest                        m_request;
+    bool                               m_doDumpXYZ = false;
+    bool                               m_doSynchronize = false;
+    unsigned int                       m_rotationCheckPeriod = 0;
+    double                             m_rotationTolerance = 0;
+    double                             m_maxRotationError = 0;
+    unsigned int                       m_numRotationChecks = 0;
+    unsigned int                       m_energyCheckPeriod = 0;
+    bool                               m_countsWork = false;
+    unsigned int                       m_numEnergyChecks = 0;
+    double                             m_firstEnergy = 0;
+    double                             m_lastEnergy = 0;
+    double                             m_maxEnergyDrift = 0;
+    double                             m_energyScale = 0;  // The largest kinetic or potential energy
 };
 
 
@@ -0,0 +1,147 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "InputManagement/MappedFile/mappedfile.h"
+#include "binarylattice.h"
+
+namespace {
+const char magic[4] = {'X', 'Y', 'Z', 'B'};
+
+struct Header {
+    char     magic[4];
+    uint32_t version;
+    int32_t  nx;
+    int32_t  ny;
+    double   d;
+    uint64_t numNodes;
+    uint64_t numTop;
+    uint64_t numBottom;
+    uint64_t numLeft;
+    uint64_t numNormal;
+    uint64_t numBonds;
+};
+static_assert(sizeof(Header) == 72, "The binary lattice header must not be padded");
+
+// Copies n elements from the file into the vector and advances the position
+template <typename T>
+void readArray(const char* &p, const char* end, size_t n, std::vector<T> &array){
+    if (static_cast<size_t>(end-p) < n*sizeof(T))
+        throw std::runtime_error("The binary lattice file is truncated");
+    array.resize(n);
+    if (n > 0)
+        memcpy(array.data(), p, n*sizeof(T));
+    p += n*sizeof(T);
+}
+
+template <typename T>
+void writeArray(std::ofstream &file, const std::vector<T> &array){
+    file.write(reinterpret_cast<const char*>(array.data()),
+               static_cast<std::streamsize>(array.size()*sizeof(T)));
+}
+}
+
+BinaryLattice::BinaryLattice()
+{
+
+}
+
+bool BinaryLattice::isBinaryPath(const std::string &path)
+{
+    const std::string extension = ".xyzb";
+    return path.size() >= extension.size()
+        && path.compare(path.size()-extension.size(), extension.size(), extension) == 0;
+}
+
+size_t BinaryLattice::count(NodeType nodeType) const
+{
+    size_t n = 0;
+    for (unsigned char t : type)
+        if (t & nodeType)
+            n++;
+    return n;
+}
+
+size_t BinaryLattice::read(const std::string &path)
+{
+    MappedFile file(path);
+    const char* p   = file.begin();
+    const char* end = file.end();
+
+    Header header;
+    if (file.size() < sizeof(Header))
+        throw std::runtime_error("The binary lattice file is truncated");
+    memcpy(&header, p, sizeof(Header));
+    p += sizeof(Header);
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0)
+        throw std::runtime_error("The file " + path + " is not a binary lattice");
+    if (header.version != version)
+        throw std::runtime_error("Unsupported binary lattice version");
+
+    nx = header.nx;
+    ny = header.ny;
+    d  = header.d;
+    const size_t numNodes = header.numNodes;
+    readArray(p, end, numNodes, x);
+    readArray(p, end, numNodes, y);
+    readArray(p, end, numNodes, type);
+    if (header.numBonds > 0){
+        readArray(p, end, numNodes+1, bondOffsets);
+        readArray(p, end, header.numBonds, bondNeighbors);
+    } else {
+        bondOffsets.clear();
+        bondNeighbors.clear();
+    }
+
+    // Validate the data that will be used to index into the lattice
+    if (header.numTop    != count(TOP)
+        || header.numBottom != count(BOTTOM)
+        || header.numLeft   != count(LEFT)
+        || header.numNormal != count(NORMAL))
+        throw std::runtime_error("The node counts of the binary lattice do not match its nodes");
+    if (hasBonds()){
+        if (bondOffsets.front() != 0 || bondOffsets.back() != header.numBonds)
+            throw std::runtime_error("The bond offsets of the binary lattice are corrupt");
+        for (size_t i = 0; i < numNodes; i++)
+            if (bondOffsets[i] > bondOffsets[i+1])
+                throw std::runtime_error("The bond offsets of the binary lattice are corrupt");
+        for (uint32_t j : bondNeighbors)
+            if (j >= numNodes)
+                throw std::runtime_error("A bond of the binary lattice refers to a missing node");
+    }
+    return file.size();
+}
+
+void BinaryLattice::write(const std::string &path) const
+{
+    if (y.size() != size() || type.size() != size())
+        throw std::runtime_error("Inconsistent binary lattice");
+    if (hasBonds() && bondOffsets.size() != size()+1)
+        throw std::runtime_error("Inconsistent bonds in binary lattice");
+
+    Header header;
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version   = version;
+    header.nx        = nx;
+    header.ny        = ny;
+    header.d         = d;
+    header.numNodes  = size();
+    header.numTop    = count(TOP);
+    header.numBottom = count(BOTTOM);
+    header.numLeft   = count(LEFT);
+    header.numNormal = count(NORMAL);
+    header.numBonds  = bondNeighbors.size();
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("The binary lattice " + path + " could not be opened");
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    writeArray(file, x);
+    writeArray(file, y);
+    writeArray(file, type);
+    if (hasBonds()){
+        writeArray(file, bondOffsets);
+        writeArray(file, bondNeighbors);
+    }
+    if (!file)
+        throw std::runtime_error("Failed to write the binary lattice " + path);
+}
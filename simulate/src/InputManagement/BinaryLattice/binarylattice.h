@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compact binary equivalent of the xyz lattice files, recognized by the
+// extension ".xyzb". All values are stored in native (little endian) byte order:
+//
+//   char[4]  "XYZB"
+//   uint32   version
+//   int32    nx, ny
+//   double   d
+//   uint64   number of nodes, top, bottom, left and normal nodes, bonds
+//   double   x[nodes], y[nodes]
+//   uint8    type[nodes]          (bitwise or of the NodeType flags)
+//   uint64   bondOffsets[nodes+1] (only if there are bonds)
+//   uint32   bondNeighbors[bonds] (only if there are bonds)
+//
+// The bonds are the neighbors of each node in compressed sparse row format,
+// given as indices into the node arrays. When present, the neighbor search
+// can be skipped when the lattice is loaded.
+class BinaryLattice
+{
+public:
+    enum NodeType : unsigned char {
+        TOP    = 1 << 0,
+        BOTTOM = 1 << 1,
+        LEFT   = 1 << 2,
+        NORMAL = 1 << 3
+    };
+    static const uint32_t version = 1;
+
+    BinaryLattice();
+    // Returns true if the path has the extension of a binary lattice
+    static bool isBinaryPath(const std::string &path);
+    // Returns the number of bytes read
+    size_t read(const std::string &path);
+    void write(const std::string &path) const;
+    size_t size() const {return x.size();}
+    bool   hasBonds() const {return !bondNeighbors.empty();}
+    size_t count(NodeType type) const;
+
+    int nx = 0;
+    int ny = 0;
+    double d = 0;
+    std::vector<double>        x;
+    std::vector<double>        y;
+    std::vector<unsigned char> type;
+    std::vector<uint64_t>      bondOffsets;
+    std::vector<uint32_t>      bondNeighbors;
+};
@@ -1,22 +1,29 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
-#include <fstream>
 #include <iostream>
 #include <iterator>
 #include <stdexcept>
 #include <memory>
 #include <limits>
+#include <omp.h>
 #include "Node/node.h"
 #include "NodeInfo/nodeinfo.h"
 #include "InputManagement/Parameters/parameters.h"
-#include "Lattice/lattice.h"
+#include "InputManagement/MappedFile/mappedfile.h"
+#include "InputManagement/BinaryLattice/binarylattice.h"
 #include "latticescanner.h"
 
 #define pi 3.14159265358979323
 
 LatticeScanner::LatticeScanner(std::shared_ptr<Parameters>  parameters,
-                               std::shared_ptr<LatticeInfo> latticeinfo):
+                               std::shared_ptr<LatticeInfo> latticeinfo,
+                               std::shared_ptr<NodeStore>   store):
     m_parameters(parameters),
-    m_latticeInfo(latticeinfo)
+    m_latticeInfo(latticeinfo),
+    m_store(store)
 {}
 
 LatticeScanner::~LatticeScanner(){}
@@ -28,92 +35,244 @@ void LatticeScanner::splitLineIntoTokens(std::string &s, std::vector<std::string
          back_inserter(tokens));
 }
 
+namespace {
+struct Entry {
+    double        x;
+    double        y;
+    unsigned char type;
+};
+
+// The nodes parsed from one chunk of the file
+struct Chunk {
+    std::vector<Entry> entries;
+    size_t             unexpectedTokens = 0;
+    std::string        badLine;
+};
+
+inline bool isBlank(char c){
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Returns the start of the first line at or after p
+const char* lineStart(const char* p, const char* begin, const char* end){
+    if (p == begin)
+        return p;
+    p = static_cast<const char*>(memchr(p-1, '\n', static_cast<size_t>(end-(p-1))));
+    return p ? p+1 : end;
+}
+
+// Parses a number the same way as std::stod, but without constructing a string
+bool parseDouble(const char* begin, const char* end, double &value){
+    char buffer[64];
+    const size_t length = static_cast<size_t>(end-begin);
+    if (length >= sizeof(buffer))
+        return false;
+    memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    char* last;
+    value = strtod(buffer, &last);
+    return last != buffer;
+}
+
+void parseChunk(const char* begin, const char* end, Chunk &chunk){
+    const char* line = begin;
+    while (line < end){
+        const char* eol = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(end-line)));
+        if (!eol)
+            eol = end;
+
+        // Split the line into at most three tokens while counting all of them
+        const char* tokenBegin[3];
+        const char* tokenEnd[3];
+        size_t numTokens = 0;
+        const char* p = line;
+        while (p < eol){
+            while (p < eol && isBlank(*p))
+                p++;
+            if (p == eol)
+                break;
+            const char* token = p;
+            while (p < eol && !isBlank(*p))
+                p++;
+            if (numTokens < 3){
+                tokenBegin[numTokens] = token;
+                tokenEnd[numTokens]   = p;
+            }
+            numTokens++;
+        }
+
+        if (numTokens > 0){
+            if (numTokens != 3)
+                chunk.unexpectedTokens++;
+
+            Entry entry;
+            entry.type = 0;
+            if (numTokens >= 3){
+                for (const char* c = tokenBegin[0]; c < tokenEnd[0]; c++){
+                    switch (*c) {
+                    case 'T': entry.type |= BinaryLattice::TOP;    break;
+                    case 'B': entry.type |= BinaryLattice::BOTTOM; break;
+                    case 'L': entry.type |= BinaryLattice::LEFT;   break;
+                    case 'N': entry.type |= BinaryLattice::NORMAL; break;
+                    default: break;
+                    }
+                }
+            }
+            if (entry.type == 0
+                || !parseDouble(tokenBegin[1], tokenEnd[1], entry.x)
+                || !parseDouble(tokenBegin[2], tokenEnd[2], entry.y)){
+                chunk.badLine.assign(line, eol);
+                return;
+            }
+            chunk.entries.push_back(entry);
+        }
+        line = eol+1;
+    }
+}
+}
+
 void LatticeScanner::scan(){
-    /* Reads the inital block of a xyz file and constructs
-       nodes accordingly
+    /* Reads the lattice file and constructs the nodes in the order they
+       appear in the file. Files with the extension .xyzb are read as
+       binary lattices, all others as xyz.
     */
+    auto startTime       = std::chrono::high_resolution_clock::now();
     std::string filename = m_parameters->get<std::string>("latticefilename");
-    int nx               = m_parameters->get<int>("nx");
-    int ny               = m_parameters->get<int>("ny");
     double d             = m_parameters->get<double>("d");
-    std::ifstream latticeFile(filename);
+    double hZ            = m_parameters->get<double>("hZ");
+    double density       = m_parameters->get<double>("density");
+    // The mass and moment of inertia are the same for every node
+    m_mass            = density * d * d * hZ/ 4* pi;
+    m_momentOfInertia = d*d / 8;
+
+    size_t bytes = BinaryLattice::isBinaryPath(filename) ? scanBinary(filename) : scanText(filename);
+
+    auto diff = std::chrono::high_resolution_clock::now() - startTime;
+    double time = std::chrono::duration_cast<std::chrono::duration<double>>(diff).count();
+    std::cout << "Scanned " << m_nodes.size() << " nodes (" << bytes << " bytes) from "
+              << filename << " in " << time << " s, " << static_cast<double>(bytes)/time/1e6 << " MB/s" << std::endl;
+    m_hasNodes = true;
+}
 
-    if (!latticeFile) {
+size_t LatticeScanner::scanText(const std::string &filename){
+    /* Reads the inital block of a xyz file.
+       The file is memory mapped and split into chunks at line boundaries.
+       The chunks are parsed in parallel, and the nodes are then constructed
+       in the order they appear in the file.
+    */
+    std::unique_ptr<MappedFile> latticeFile;
+    try {
+        latticeFile = std::unique_ptr<MappedFile>(new MappedFile(filename));
+    } catch (std::exception &) {
         throw std::runtime_error("The lattice file could not be read");
     }
+    if (latticeFile->size() == 0)
+        throw std::runtime_error("The lattice file is empty");
+    const char* begin = latticeFile->begin();
+    const char* end   = latticeFile->end();
 
-    std::string firstLine;
-    std::string comment;
-    std::string line;
-    getline(latticeFile, firstLine);
-    getline(latticeFile, comment);
+    // The first line holds the number of nodes and the second the comment
+    const char* firstEnd = static_cast<const char*>(memchr(begin, '\n', latticeFile->size()));
+    if (!firstEnd)
+        firstEnd = end;
+    const char* commentBegin = firstEnd < end ? firstEnd+1 : end;
+    const char* commentEnd   = static_cast<const char*>(memchr(commentBegin, '\n', static_cast<size_t>(end-commentBegin)));
+    if (!commentEnd)
+        commentEnd = end;
+    const char* body = commentEnd < end ? commentEnd+1 : end;
+    std::string firstLine(begin, firstEnd);
+    std::string comment(commentBegin, commentEnd);
     parseComment(comment);
+    checkDimensions();
 
-    // Confirm that the scanned lattice is the same as described in the parameter file
-    if (!validateLattice(nx, ny, d)){
-        std::string msg = "The parameter file and the lattice file are not equivalent.\nReason:\n";
-        msg += reasonForInvalidation(nx, ny, d);
-        throw std::runtime_error(msg);
-    }
+    size_t totalNumNodes = std::stoul(firstLine);
 
-    size_t totalNumNodes = std::stoi(firstLine);
-
-    while (getline(latticeFile, line)) {
-        std::vector<std::string> tokens;
-        splitLineIntoTokens(line, tokens);
-
-        // Accept differing number of columns
-        switch (tokens.size()) {
-        case 0:
-            continue;
-        case 3:
-            break;
-        default: {
-            std::cerr << "Warning: A line in " << filename << " contained an unexpected number of tokens."
-                      << std::endl;
-            break;
-        }
-        }
+    // Use several chunks per thread to even out the load, but keep them large
+    const size_t minChunkSize = 1 << 16;
+    const size_t bodySize     = static_cast<size_t>(end-body);
+    const size_t numChunks    = std::max<size_t>(1, std::min<size_t>(4*static_cast<size_t>(omp_get_max_threads()),
+                                                                     bodySize/minChunkSize));
+    std::vector<Chunk> chunks(numChunks);
+#pragma omp parallel for schedule(dynamic)
+    for (size_t c = 0; c < numChunks; c++){
+        const char* chunkBegin = lineStart(body + c*bodySize/numChunks, body, end);
+        const char* chunkEnd   = lineStart(body + (c+1)*bodySize/numChunks, body, end);
+        chunks[c].entries.reserve(totalNumNodes/numChunks+1);
+        parseChunk(chunkBegin, chunkEnd, chunks[c]);
+    }
 
-        // Parse the tokens
-        double x = std::stod(tokens[1]);
-        double y = std::stod(tokens[2]);
-
-        // Construct the node
-        std::shared_ptr<Node> node = Lattice::newNode(m_parameters, m_latticeInfo, x, y);
-        // Use the letters in the first column to determine the node type
-        bool foundChar = false;
-        if (tokens[0].find("T") != std::string::npos){
-            m_topNodes.push_back(node);
-            foundChar = true;
-        }
-        if (tokens[0].find("B") != std::string::npos){
-            m_bottomNodes.push_back(node);
-            foundChar = true;
-        }
-        if (tokens[0].find("L") != std::string::npos){
-            m_leftNodes.push_back(node);
-            foundChar = true;
-        }
-        if (tokens[0].find("N") != std::string::npos){
-            m_normalNodes.push_back(node);
-            foundChar = true;
-        }
-        if (!foundChar){
-            std::cerr << "Unrecongized character in line " << line << std::endl;
+    m_store->reserve(totalNumNodes);
+    m_nodes.reserve(totalNumNodes);
+    size_t unexpectedTokens = 0;
+    for (auto & chunk : chunks){
+        unexpectedTokens += chunk.unexpectedTokens;
+        for (auto & entry : chunk.entries)
+            addNode(entry.x, entry.y, entry.type);
+        if (!chunk.badLine.empty()){
+            std::cerr << "Unrecongized character in line " << chunk.badLine << std::endl;
             throw std::runtime_error("Unable to parse lattice file");
         }
-        m_nodes.push_back(node);
     }
 
+    // Accept differing number of columns
+    if (unexpectedTokens > 0)
+        std::cerr << "Warning: " << unexpectedTokens << " lines in " << filename
+                  << " contained an unexpected number of tokens." << std::endl;
+
     // Check if the number of nodes specified in the first line is equal to
     // the number of nodes contructed
     if (m_nodes.size() != totalNumNodes) {
         std::cerr << "Warning: Expected " << totalNumNodes << " entries, but only " <<
                      m_nodes.size() << " nodes were constructed" << std::endl;
     }
-    latticeFile.close();
-    m_hasNodes = true;
+    return latticeFile->size();
+}
+
+size_t LatticeScanner::scanBinary(const std::string &filename){
+    BinaryLattice lattice;
+    size_t bytes = lattice.read(filename);
+    m_readnx = lattice.nx;
+    m_readny = lattice.ny;
+    m_readd  = lattice.d;
+    checkDimensions();
+
+    m_store->reserve(lattice.size());
+    m_nodes.reserve(lattice.size());
+    for (size_t i = 0; i < lattice.size(); i++){
+        if (!lattice.type[i])
+            throw std::runtime_error("Unable to parse lattice file");
+        addNode(lattice.x[i], lattice.y[i], lattice.type[i]);
+    }
+    m_bondOffsets.swap(lattice.bondOffsets);
+    m_bondNeighbors.swap(lattice.bondNeighbors);
+
+    return bytes;
+}
+
+void LatticeScanner::addNode(double x, double y, unsigned char type){
+    vec3 pos(x, y, 0);
+    auto node = std::make_shared<Node>(m_store, pos, m_mass, m_momentOfInertia, m_latticeInfo);
+    if (type & BinaryLattice::TOP)
+        m_topNodes.push_back(node);
+    if (type & BinaryLattice::BOTTOM)
+        m_bottomNodes.push_back(node);
+    if (type & BinaryLattice::LEFT)
+        m_leftNodes.push_back(node);
+    if (type & BinaryLattice::NORMAL)
+        m_normalNodes.push_back(node);
+    m_nodes.push_back(node);
+}
+
+void LatticeScanner::checkDimensions(){
+    // Confirm that the scanned lattice is the same as described in the parameter file
+    int nx    = m_parameters->get<int>("nx");
+    int ny    = m_parameters->get<int>("ny");
+    double d  = m_parameters->get<double>("d");
+    if (!validateLattice(nx, ny, d)){
+        std::string msg = "The parameter file and the lattice file are not equivalent.\nReason:\n";
+        msg += reasonForInvalidation(nx, ny, d);
+        throw std::runtime_error(msg);
+    }
 }
 
 void LatticeScanner::parseComment(std::string &comment){
@@ -1,9 +1,11 @@
 #pragma once
-#include <fstream>
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <memory>
 
 class Node;
+class NodeStore;
 class Parameters;
 class LatticeInfo;
 
@@ -11,16 +13,21 @@ class LatticeScanner
 {
 public:
     explicit LatticeScanner(std::shared_ptr<Parameters>,
-                            std::shared_ptr<LatticeInfo>);
+                            std::shared_ptr<LatticeInfo>,
+                            std::shared_ptr<NodeStore>);
     virtual ~LatticeScanner();
 
-    // Scans the file (xyz-format) and constructs the nodes
+    // Scans the file (xyz-format, or binary if the extension is .xyzb)
+    // and constructs the nodes. Text files are memory mapped and parsed in parallel
     // TODO: Move scan into the constructor?
     void scan();
     void splitLineIntoTokens(std::string &s, std::vector<std::string> &tokens);
     // Extracts nx, ny and d from the comment string
     void parseComment(std::string &comment);
     bool hasNodes(){return m_hasNodes;};
+    // True if the file contained the bonds of the lattice, in which case
+    // m_bondOffsets and m_bondNeighbors hold them in CSR format
+    bool hasBonds(){return !m_bondNeighbors.empty();};
     // Returns true if the scanned lattice has the same
     // dimensions and distance d as the parameters in
     // the parameter file
@@ -33,11 +40,23 @@ public:
     std::vector<std::shared_ptr<Node>> m_topNodes;
     std::vector<std::shared_ptr<Node>> m_leftNodes;
     std::vector<std::shared_ptr<Node>> m_normalNodes;
+    std::vector<uint64_t>              m_bondOffsets;
+    std::vector<uint32_t>              m_bondNeighbors;
 private:
+    // Both return the number of bytes read
+    size_t scanText(const std::string &filename);
+    size_t scanBinary(const std::string &filename);
+    void   addNode(double x, double y, unsigned char type);
+    // Throws if the lattice does not match nx, ny and d of the parameters
+    void   checkDimensions();
+
     std::shared_ptr<Parameters>  m_parameters;
     std::shared_ptr<LatticeInfo> m_latticeInfo;
+    std::shared_ptr<NodeStore>   m_store;
     bool                         m_hasNodes = false;
     int                          m_readnx;
     int                          m_readny;
     double                       m_readd;
+    double                       m_mass;
+    double                       m_momentOfInertia;
 };
@@ -0,0 +1,39 @@
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mappedfile.h"
+
+MappedFile::MappedFile(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("The file " + path + " could not be opened");
+
+    struct stat info;
+    if (fstat(fd, &info) != 0){
+        close(fd);
+        throw std::runtime_error("The file " + path + " could not be read");
+    }
+    m_size = static_cast<size_t>(info.st_size);
+
+    // mmap does not accept empty mappings
+    if (m_size > 0){
+        void* map = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED){
+            close(fd);
+            throw std::runtime_error("The file " + path + " could not be mapped");
+        }
+        madvise(map, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(map);
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        munmap(const_cast<char*>(m_data), m_size);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory map of a whole file. The contents are available through
+// data() and size() until the object is destroyed.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const {return m_data;}
+    size_t      size() const {return m_size;}
+    const char* begin() const {return m_data;}
+    const char* end() const {return m_data + m_size;}
+private:
+    const char* m_data = nullptr;
+    size_t      m_size = 0;
+};
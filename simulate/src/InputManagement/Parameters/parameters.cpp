@@ -101,6 +101,7 @@ void Parameters::constructMap(){
     addParameter<int>("ns");
     addParameter<double>("tRmean");
     addParameter<double>("tRstd");
+    addParameter<int>("randomSeed");
     addParameter<double>("d");
     addParameter<double>("E");
     addParameter<double>("k");
@@ -108,6 +109,7 @@ void Parameters::constructMap(){
     addParameter<double>("hZ");
     addParameter<double>("density");
     addParameter<double>("step");
+    addParameter<int>("interfaceSubsteps");
     addParameter<double>("mud");
     addParameter<double>("mus");
     addParameter<double>("absDampCoeff");
@@ -133,6 +135,7 @@ void Parameters::constructMap(){
     addParameter<bool>("writeInterfaceAttachedSprings");
     addParameter<bool>("writeInterfaceNormalForce");
     addParameter<bool>("writeInterfaceShearForce");
+    addParameter<bool>("writeInterfaceContactEvents");
     addParameter<bool>("writeAllPosition");
     addParameter<bool>("writeAllVelocity");
     addParameter<bool>("writeAllEnergy");
@@ -141,11 +144,17 @@ void Parameters::constructMap(){
     addParameter<bool>("writeXYZ");
     addParameter<bool>("writeBeamTorque");
     addParameter<bool>("writeBeamShearForce");
+    addParameter<bool>("writeLatticeBinary");
+    addParameter<std::string>("outputFormat");
+    addParameter<int>("outputChunkSize");
+    addParameter<std::string>("outputCompression");
+    addParameter<double>("outputTolerance");
     addParameter<int>("freqInterfacePosition");
     addParameter<int>("freqInterfaceVelocity");
     addParameter<int>("freqInterfaceAttachedSprings");
     addParameter<int>("freqInterfaceNormalForce");
     addParameter<int>("freqInterfaceShearForce");
+    addParameter<int>("freqInterfaceContactEvents");
     addParameter<int>("freqAllPosition");
     addParameter<int>("freqAllVelocity");
     addParameter<int>("freqAllEnergy");
@@ -154,6 +163,19 @@ void Parameters::constructMap(){
     addParameter<int>("freqXYZ");
     addParameter<int>("freqBeamTorque");
     addParameter<int>("freqBeamShearForce");
+    addParameter<std::string>("forceKernel");
+    addParameter<std::string>("bondRotation");
+    addParameter<int>("bondRotationCheck");
+    addParameter<double>("bondRotationTolerance");
+    addParameter<int>("energyCheck");
+    addParameter<std::string>("memoryPlacement");
+    addParameter<std::string>("nodeOrdering");
+    addParameter<int>("outputQueueLength");
+    addParameter<std::string>("parallelRegion");
+    addParameter<int>("numThreads");
+    addParameter<std::string>("ompSchedule");
+    addParameter<int>("ompChunkSize");
+    addParameter<std::string>("threadBinding");
 }
 
 
@@ -36,7 +36,7 @@ void TriangularLattice::populate(std::shared_ptr<Parameters> parameters, int nx,
             double rx = i*d+(j%2)*d*cos(pi/3);
             double ry = j*d*sin(pi/3);
             vec3 pos(rx, ry,0);
-            std::shared_ptr<Node> newNode= std::make_shared<Node>(pos, density*d*d*hZ/4*pi, d*d/8, latticeInfo);
+            std::shared_ptr<Node> newNode= std::make_shared<Node>(store, pos, density*d*d*hZ/4*pi, d*d/8, latticeInfo);
             nodes.push_back(newNode);
 
             bool normal = true;
@@ -68,7 +68,7 @@ void TriangularLattice::populate(std::shared_ptr<Parameters> parameters, int nx,
         double rx = i*d+(j%2)*d*cos(pi/3);
         double ry = j*d*sin(pi/3);
         vec3 pos(rx, ry,0);
-        std::shared_ptr<Node> newNode= std::make_shared<Node>(pos, density*d*d*hZ/4*pi, d*d/8, latticeInfo);
+        std::shared_ptr<Node> newNode= std::make_shared<Node>(store, pos, density*d*d*hZ/4*pi, d*d/8, latticeInfo);
         nodes.push_back(newNode);
         if (j == 0)
         {
@@ -81,17 +81,8 @@ void TriangularLattice::populate(std::shared_ptr<Parameters> parameters, int nx,
     }
     */
 
-    for (auto & node : nodes)
-    {
-        node->setLattice(shared_from_this());
-        for (auto & node2: nodes)
-        {
-            if (node->distanceTo(*node2) < d*1.01 && node->distanceTo(*node2) > d*0.01)
-            {
-                node->connectToNode(node2);
-            }
-        }
-    }
+    connectNodes(d);
+    buildBondList(parameters);
 }
 
 void TriangularLattice::populateWithUnitCell(std::shared_ptr<Parameters> parameters)
@@ -110,7 +101,7 @@ void TriangularLattice::populateWithUnitCell(std::shared_ptr<Parameters> paramet
             double rx = i*d+(j%2)*d*cos(pi/3);
             double ry = j*d*sin(pi/3);
             vec3 pos(rx, ry,0);
-            auto node = std::make_shared<Node>(pos, density*d*d*hZ/4*pi, d*d/8, latticeInfo);
+            auto node = std::make_shared<Node>(store, pos, density*d*d*hZ/4*pi, d*d/8, latticeInfo);
             nodes.push_back(node);
             normalNodes.push_back(node);
         }
@@ -118,18 +109,10 @@ void TriangularLattice::populateWithUnitCell(std::shared_ptr<Parameters> paramet
     double rx = -d*cos(pi/3);
     double ry = d*sin(pi/3);
     vec3 pos(rx, ry,0);
-    nodes.push_back(std::make_shared<Node>(pos, density*d*d*hZ/4*pi, d*d/8, latticeInfo));
+    nodes.push_back(std::make_shared<Node>(store, pos, density*d*d*hZ/4*pi, d*d/8, latticeInfo));
 
-    for (auto & node : nodes)
-    {
-        for (auto & node2: nodes)
-        {
-            if (node->distanceTo(*node2) < d*1.01 && node->distanceTo(*node2) > d*0.01)
-            {
-                node->connectToNode(node2);
-            }
-        }
-    }
+    connectNodes(d);
+    buildBondList(parameters);
 }
 
 void TriangularLattice::populateCantilever(std::shared_ptr<Parameters> parameters)
@@ -144,26 +127,18 @@ void TriangularLattice::populateCantilever(std::shared_ptr<Parameters> parameter
     double rx = 0;
     double ry = d;
     vec3 pos(rx, ry,0);
-    auto node1 = std::make_shared<Node>(pos, density*d*d*hZ/4*pi, d*d/8, latticeInfo);
+    auto node1 = std::make_shared<Node>(store, pos, density*d*d*hZ/4*pi, d*d/8, latticeInfo);
     nodes.push_back(node1);
     normalNodes.push_back(node1);
 
     double rx2 = d;
     double ry2 = d;
     vec3 pos2(rx2, ry2,0);
-    auto node2 = std::make_shared<Node>(pos2, density*d*d*hZ/4*pi, d*d/8, latticeInfo);
+    auto node2 = std::make_shared<Node>(store, pos2, density*d*d*hZ/4*pi, d*d/8, latticeInfo);
     nodes.push_back(node2);
     normalNodes.push_back(node2);
 
-    for (auto & node : nodes)
-    {
-        for (auto & node2: nodes)
-        {
-            if (node->distanceTo(*node2) < d*1.01 && node->distanceTo(*node2) > d*0.01)
-            {
-                node->connectToNode(node2);
-            }
-        }
-    }
+    connectNodes(d);
+    buildBondList(parameters);
 }
 
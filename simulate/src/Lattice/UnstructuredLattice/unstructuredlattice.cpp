@@ -15,7 +15,8 @@ void UnstructuredLattice::populate(std::shared_ptr<Parameters> parameters){
     latticeInfo = latticeInfoFromParameters(parameters);
 
     LatticeScanner scanner = LatticeScanner(parameters,
-                                            latticeInfo);
+                                            latticeInfo,
+                                            store);
 
     scanner.scan();
     // Confirm that the scanner has indeed scanned a lattice
@@ -28,19 +29,12 @@ void UnstructuredLattice::populate(std::shared_ptr<Parameters> parameters){
     leftNodes   = scanner.m_leftNodes;
     normalNodes = scanner.m_normalNodes;
     nodes       = scanner.m_nodes;
-    connectNodes();
-}
-
-void UnstructuredLattice::connectNodes(){
-    for (auto & node : nodes)
-    {
-        node->setLattice(shared_from_this());
-        for (auto & node2: nodes)
-        {
-            if (node->distanceTo(*node2) < m_d*1.01 && node->distanceTo(*node2) > m_d*0.01)
-                node->connectToNode(node2);
-        }
-    }
+    // Binary lattices may carry their bonds, which saves the neighbor search
+    if (scanner.hasBonds())
+        connectNodes(scanner.m_bondOffsets, scanner.m_bondNeighbors);
+    else
+        connectNodes(m_d);
+    buildBondList(parameters);
 }
 
 void UnstructuredLattice::populate(std::shared_ptr<Parameters> parameters, int nx, int ny){
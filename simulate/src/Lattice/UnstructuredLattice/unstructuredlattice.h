@@ -20,7 +20,6 @@ public:
     void populate(std::shared_ptr<Parameters> parameters) override;
     void populate(std::shared_ptr<Parameters>, int nx, int ny) override;
 protected:
-    void connectNodes();
     int m_nx;
     int m_ny;
     double m_d;
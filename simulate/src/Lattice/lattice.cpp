@@ -1,16 +1,21 @@
 #include <omp.h>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <typeindex>
 #include "lattice.h"
 #include "InputManagement/Parameters/parameters.h"
 #include "LatticeInfo/latticeinfo.h"
 #include "DataOutput/datapacket.h"
-
-#ifndef NUM_THREADS
-    #define NUM_THREADS 4
-#endif // NUM_THREADS
+#include "NodeStore/placement.h"
+#include "NodeOrdering/nodeordering.h"
+#include "ForceModifier/RelativeVelocityDamper/relativevelocitydamper.h"
 
 #define pi 3.14159265358979323
 
 Lattice::Lattice()
+    : store(std::make_shared<NodeStore>()),
+      bonds(std::make_shared<BondList>())
 {
 
 }
@@ -22,29 +27,527 @@ Lattice::~Lattice()
 
 void Lattice::step(double dt)
 {
-    omp_set_num_threads( NUM_THREADS );
-#pragma omp flush(dt)
+    /* Velocity Verlet as kick, drift, force, kick. The closing kick of the
+       previous step is deferred and fused with the opening kick and the drift
+       of this one, so the nodes are swept once before and once during the
+       force update instead of twice. Per node the fused sweep reads the
+       force, moment, mass, inertia and flags and updates the velocities and
+       positions, 12 arrays or about 137 bytes, where the separate kick and
+       drift sweeps of the two halves moved 274 bytes and forked twice.
+       The two kicks are still applied one after the other, so the result is
+       the same whether or not the lattice was synchronized in between.
+    */
+#pragma omp parallel
+    parallelStep(dt);
+}
+
+void Lattice::parallelStep(double dt)
+{
+    /* The loops are shared by the threads of the enclosing region with the
+       schedule set by ThreadConfig. With the default static schedule a thread
+       works on the same nodes in every sweep and every step. The serial
+       updates are done by a single thread, and the implicit barriers of the
+       loops and of single order the phases.
+    */
+    if (m_substeps > 1){
+        parallelMultiRateStep(dt);
+        return;
+    }
+    NodeStore & s = *store;
+    const size_t numNodes = s.size();
+    const bool   closeStep = !m_synchronized;
+
+#pragma omp for schedule(runtime)
+    for (size_t i = 0; i<numNodes; i++)
+    {
+        if (s.isIntegrated(i)){
+            if (closeStep)
+                s.kick(i, m_dt);
+            s.kick(i, dt);
+            s.drift(i, dt);
+        }
+    }
+#pragma omp single
+    {
+        for (auto & node : m_externalNodes){
+            if (closeStep)
+                node->vvstep2(m_dt);
+            node->vvstep1(dt);
+        }
+        m_t += dt;
+        m_dt = dt;
+        m_synchronized = false;
+        if (m_modifiersChanged){
+            buildModifierBatches();
+            m_modifiersChanged = false;
+        }
+    }
+
+    bonds->updateForcesAndMoments(s, *latticeInfo);
+    for (auto & batch : m_modifierBatches)
+        batch->apply(s, *bonds, m_t);
+#pragma omp for schedule(runtime)
+    for (size_t i = 0; i<m_unbatchedNodes.size(); i++)
+    {
+        m_unbatchedNodes[i]->updateForcesAndMoments();
+    }
+}
+
+void Lattice::parallelMultiRateStep(double dt)
+{
+    /* Multiple time stepping (r-RESPA). The slow forces, those of the beams
+       and of the other modifiers, kick the velocities by half a step at the
+       start and at the end of the step. In between, the substepped nodes
+       take substeps of velocity Verlet with their fast forces, while the
+       other nodes drift for the whole step, which is the same as drifting in
+       substeps without any force to change their velocity. Only the
+       interface nodes are swept in the substeps, so the step can be as long
+       as the beams allow, with the interface resolved by the substeps. As in
+       parallelStep the closing kicks are deferred.
+       The interface carries the load of the beams, so the slow force on a
+       substepped node is mostly balanced by its fast force. Kicked in two
+       halves it would set the node ringing on the interface by about
+       (F dt)^2/8m each step, however many the substeps. So the slow force
+       from the start of the step is held through the substeps, as a
+       constant force along with the fast one, and only its change over the
+       step is kicked at the end. At the start that kick is zero.
 
-#pragma omp parallel for
-    for (size_t i = 0; i<nodes.size(); i++)
+       The closing kick must split the forces as the opening kick of the step
+       did, so the lattice is synchronized before the batches are rebuilt.
+       Every thread reads m_modifiersChanged before the barrier, and only
+       then is it cleared.
+    */
+    NodeStore & s = *store;
+    const size_t numNodes = s.size();
+    if (m_modifiersChanged){
+        parallelSynchronize();
+#pragma omp barrier
+#pragma omp single
+        {
+            buildModifierBatches();
+            m_modifiersChanged = false;
+        }
+    }
+    const size_t numSubstepped = m_substepped.size();
+    const bool   closeStep = !m_synchronized;
+    const double subDt     = dt/m_substeps;
+
+    // The substepped nodes are only rotated here, so the loops touch
+    // different arrays and need not wait for each other
+#pragma omp for schedule(runtime) nowait
+    for (size_t i = 0; i<numNodes; i++)
+    {
+        if (!s.isIntegrated(i))
+            continue;
+        if (s.isSubstepped(i)){
+            if (closeStep)
+                s.kickRotation(i, m_dt);
+            s.kickRotation(i, dt);
+            s.driftRotation(i, dt);
+        } else {
+            if (closeStep)
+                s.kick(i, m_dt);
+            s.kick(i, dt);
+            s.drift(i, dt);
+        }
+    }
+#pragma omp for schedule(runtime)
+    for (size_t k = 0; k<numSubstepped; k++)
     {
-        nodes[i]->vvstep(dt);
+        const size_t i = m_substepped[k];
+        // Until the end of the step the force of the node is the fast one
+        s.fx[i] = m_fastFx[k];
+        s.fy[i] = m_fastFy[k];
+        if (s.isIntegrated(i) && closeStep){
+            s.vx[i] += ((m_slowFx[k] - m_heldFx[k])/s.mass[i])*0.5*m_dt;
+            s.vy[i] += ((m_slowFy[k] - m_heldFy[k])/s.mass[i])*0.5*m_dt;
+            s.vx[i] += ((m_fastFx[k] + m_heldFx[k])/s.mass[i])*0.5*m_subDt;
+            s.vy[i] += ((m_fastFy[k] + m_heldFy[k])/s.mass[i])*0.5*m_subDt;
+        }
+        m_heldFx[k] = m_slowFx[k];
+        m_heldFy[k] = m_slowFy[k];
+    }
+#pragma omp single
+    {
+        for (auto & node : m_externalNodes){
+            if (closeStep)
+                node->vvstep2(m_dt);
+            node->vvstep1(dt);
+        }
+        m_t += dt;
+        m_dt = dt;
+        m_subDt = subDt;
+        m_synchronized = false;
     }
 
-    m_t += dt*0.5;
+    const double tBegin = m_t - dt;
+    for (int n = 1; n <= m_substeps; n++){
+#pragma omp for schedule(runtime)
+        for (size_t k = 0; k<numSubstepped; k++)
+        {
+            const size_t i = m_substepped[k];
+            if (s.isIntegrated(i)){
+                // The closing kick of the last substep and the opening kick of this one
+                const double fx = s.fx[i] + m_heldFx[k];
+                const double fy = s.fy[i] + m_heldFy[k];
+                if (n > 1){
+                    s.vx[i] += (fx/s.mass[i])*0.5*subDt;
+                    s.vy[i] += (fy/s.mass[i])*0.5*subDt;
+                }
+                s.vx[i] += (fx/s.mass[i])*0.5*subDt;
+                s.vy[i] += (fy/s.mass[i])*0.5*subDt;
+                s.x[i]  += s.vx[i]*subDt;
+                s.y[i]  += s.vy[i]*subDt;
+            }
+            s.fx[i] = 0;
+            s.fy[i] = 0;
+        }
+        const double t = n == m_substeps ? m_t : tBegin + n*subDt;
+        for (auto & batch : m_modifierBatches)
+            if (batch->isFast())
+                batch->apply(s, *bonds, t);
+    }
+#pragma omp for schedule(runtime)
+    for (size_t k = 0; k<numSubstepped; k++)
+    {
+        m_fastFx[k] = s.fx[m_substepped[k]];
+        m_fastFy[k] = s.fy[m_substepped[k]];
+    }
 
-#pragma omp parallel for
-    for (size_t i = 0; i<nodes.size(); i++)
+    bonds->updateForcesAndMoments(s, *latticeInfo);
+    for (auto & batch : m_modifierBatches)
+        if (!batch->isFast())
+            batch->apply(s, *bonds, m_t);
+#pragma omp for schedule(runtime)
+    for (size_t i = 0; i<m_unbatchedNodes.size(); i++)
+    {
+        m_unbatchedNodes[i]->updateForcesAndMoments();
+    }
+    // The store is left with the whole force, as after parallelStep
+#pragma omp for schedule(runtime)
+    for (size_t k = 0; k<numSubstepped; k++)
     {
-        nodes[i]->updateForcesAndMoments();
+        const size_t i = m_substepped[k];
+        m_slowFx[k] = s.fx[i];
+        m_slowFy[k] = s.fy[i];
+        s.fx[i]    += m_fastFx[k];
+        s.fy[i]    += m_fastFy[k];
     }
+}
 
-#pragma omp parallel for
-    for (size_t i = 0; i<nodes.size(); i++)
+void Lattice::synchronize()
+{
+    if (m_synchronized)
+        return;
+#pragma omp parallel
+    parallelSynchronize();
+}
+
+void Lattice::parallelSynchronize()
+{
+    if (m_synchronized)
+        return;
+    NodeStore & s = *store;
+    const size_t numNodes = s.size();
+    // The substepped nodes are kicked as the forces were split in the step
+#pragma omp for schedule(runtime) nowait
+    for (size_t i = 0; i<numNodes; i++)
     {
-        nodes[i]->vvstep(dt);
+        if (s.isIntegrated(i)){
+            if (s.isSubstepped(i))
+                s.kickRotation(i, m_dt);
+            else
+                s.kick(i, m_dt);
+        }
+    }
+#pragma omp for schedule(runtime)
+    for (size_t k = 0; k<m_substepped.size(); k++)
+    {
+        const size_t i = m_substepped[k];
+        if (s.isIntegrated(i)){
+            s.vx[i] += ((m_slowFx[k] - m_heldFx[k])/s.mass[i])*0.5*m_dt;
+            s.vy[i] += ((m_slowFy[k] - m_heldFy[k])/s.mass[i])*0.5*m_dt;
+            s.vx[i] += ((m_fastFx[k] + m_heldFx[k])/s.mass[i])*0.5*m_subDt;
+            s.vy[i] += ((m_fastFy[k] + m_heldFy[k])/s.mass[i])*0.5*m_subDt;
+        }
+    }
+#pragma omp single
+    {
+        for (auto & node : m_externalNodes)
+            node->vvstep2(m_dt);
+        m_synchronized = true;
+    }
+}
+
+void Lattice::connectNodes(double d)
+{
+    /* Bins the nodes into a uniform grid of cells with side 1.01*d, so that
+       all neighbors of a node are found in the 3x3 block of cells around it.
+       The cells are stored in compressed sparse row format.
+    */
+    const size_t numNodes = nodes.size();
+    if (numNodes == 0)
+        return;
+    const double cutoff = d*1.01;
+    std::vector<double> xs(numNodes);
+    std::vector<double> ys(numNodes);
+    for (size_t k = 0; k < numNodes; k++){
+        xs[k] = nodes[k]->r().x();
+        ys[k] = nodes[k]->r().y();
+    }
+    const double xMin = *std::min_element(xs.begin(), xs.end());
+    const double yMin = *std::min_element(ys.begin(), ys.end());
+    const double xMax = *std::max_element(xs.begin(), xs.end());
+    const double yMax = *std::max_element(ys.begin(), ys.end());
+    const size_t nCellsX = static_cast<size_t>((xMax-xMin)/cutoff) + 1;
+    const size_t nCellsY = static_cast<size_t>((yMax-yMin)/cutoff) + 1;
+
+    std::vector<size_t> cellOf(numNodes);
+    std::vector<size_t> cellStart(nCellsX*nCellsY+1, 0);
+    for (size_t k = 0; k < numNodes; k++){
+        const size_t cx = static_cast<size_t>((xs[k]-xMin)/cutoff);
+        const size_t cy = static_cast<size_t>((ys[k]-yMin)/cutoff);
+        cellOf[k] = cy*nCellsX + cx;
+        cellStart[cellOf[k]+1]++;
+    }
+    for (size_t c = 1; c < cellStart.size(); c++)
+        cellStart[c] += cellStart[c-1];
+    std::vector<size_t> cellNodes(numNodes);
+    std::vector<size_t> fill(cellStart.begin(), cellStart.end()-1);
+    for (size_t k = 0; k < numNodes; k++)
+        cellNodes[fill[cellOf[k]]++] = k;
+
+    auto self = shared_from_this();
+#pragma omp parallel for schedule(static)
+    for (size_t k = 0; k < numNodes; k++){
+        nodes[k]->setLattice(self);
+        const size_t cx = cellOf[k] % nCellsX;
+        const size_t cy = cellOf[k] / nCellsX;
+        const size_t yBegin = cy > 0 ? cy-1 : 0;
+        const size_t yEnd   = cy+1 < nCellsY ? cy+2 : nCellsY;
+        const size_t xBegin = cx > 0 ? cx-1 : 0;
+        const size_t xEnd   = cx+1 < nCellsX ? cx+2 : nCellsX;
+        std::vector<size_t> candidates;
+        for (size_t ny = yBegin; ny < yEnd; ny++){
+            for (size_t nx = xBegin; nx < xEnd; nx++){
+                const size_t cell = ny*nCellsX + nx;
+                for (size_t c = cellStart[cell]; c < cellStart[cell+1]; c++){
+                    const size_t other = cellNodes[c];
+                    const double distance = nodes[k]->distanceTo(*nodes[other]);
+                    if (distance < cutoff && distance > d*0.01)
+                        candidates.push_back(other);
+                }
+            }
+        }
+        // Keep the neighbors in the order of the nodes
+        std::sort(candidates.begin(), candidates.end());
+        for (size_t other : candidates)
+            nodes[k]->connectToNode(nodes[other]);
     }
-    m_t += dt*0.5;
+}
+
+void Lattice::connectNodes(const std::vector<uint64_t> &offsets, const std::vector<uint32_t> &neighbors)
+{
+    const size_t numNodes = nodes.size();
+    if (offsets.size() != numNodes+1 || offsets.back() != neighbors.size())
+        throw std::runtime_error("The bond list does not match the nodes of the lattice");
+
+    auto self = shared_from_this();
+#pragma omp parallel for schedule(static)
+    for (size_t k = 0; k < numNodes; k++){
+        nodes[k]->setLattice(self);
+        for (uint64_t b = offsets[k]; b < offsets[k+1]; b++)
+            nodes[k]->connectToNode(nodes[neighbors[b]]);
+    }
+}
+
+void Lattice::buildBondList(std::shared_ptr<Parameters> parameters)
+{
+    bonds->build(nodes, store->size());
+    reorderNodes(parameters);
+
+    auto kernel = parameters->get<std::string>("forceKernel");
+    std::transform(kernel.begin(), kernel.end(), kernel.begin(), ::tolower);
+    if (kernel == "full")
+        bonds->setKernel(BondList::Kernel::FULL);
+    else if (kernel == "half")
+        bonds->setKernel(BondList::Kernel::HALF);
+    else if (kernel == "simd"){
+        bonds->setKernel(BondList::Kernel::SIMD);
+        std::cout << "Beam forces by the SIMD kernel for " << BondList::simdTarget() << std::endl;
+    }
+    else
+        throw std::runtime_error("forceKernel is not recognized");
+
+    auto rotation = parameters->get<std::string>("bondRotation");
+    std::transform(rotation.begin(), rotation.end(), rotation.begin(), ::tolower);
+    if (rotation == "exact")
+        bonds->setRotation(BondList::Rotation::EXACT);
+    else if (rotation == "smallangle")
+        bonds->setRotation(BondList::Rotation::SMALL_ANGLE);
+    else
+        throw std::runtime_error("bondRotation is not recognized");
+
+    m_substeps = parameters->get<int>("interfaceSubsteps");
+    if (m_substeps < 1)
+        throw std::runtime_error("interfaceSubsteps must be positive");
+
+    // The lattice is complete, so its arrays can be moved to their threads
+    auto placement = parameters->get<std::string>("memoryPlacement");
+    std::transform(placement.begin(), placement.end(), placement.begin(), ::tolower);
+    if (placement == "serial"){
+        return;
+    } else if (placement == "local"){
+        store->place(Placement::LOCAL);
+        bonds->place(Placement::LOCAL);
+    } else if (placement == "interleave"){
+        store->place(Placement::INTERLEAVE);
+        bonds->place(Placement::INTERLEAVE);
+    } else {
+        throw std::runtime_error("memoryPlacement is not recognized");
+    }
+}
+
+void Lattice::reorderNodes(std::shared_ptr<Parameters> parameters)
+{
+    auto kind = NodeOrdering::kind(parameters->get<std::string>("nodeOrdering"));
+    if (kind == NodeOrdering::Kind::NONE)
+        return;
+    const double d = parameters->get<double>("d");
+    std::vector<size_t> order = NodeOrdering::order(kind, store->x, store->y, d,
+                                                    bonds->offsets, bonds->neighbor);
+    std::vector<size_t> newIndex(order.size());
+    for (size_t k = 0; k < order.size(); k++)
+        newIndex[order[k]] = k;
+
+    // The nodes are views into the store, so moving the state and updating
+    // their indices keeps every list of nodes valid
+    store->permute(order);
+    for (auto & node : nodes)
+        if (node->store() == store)
+            node->m_index = newIndex[node->m_index];
+    // The bonds of each node keep their order, and so the sums of the forces
+    bonds->build(nodes, store->size());
+    m_modifiersChanged = true;
+}
+
+void Lattice::addExternalNode(std::shared_ptr<Node> node)
+{
+    nodes.push_back(node);
+    m_externalNodes.push_back(node);
+    m_modifiersChanged = true;
+}
+
+void Lattice::buildModifierBatches()
+{
+    /* The batches are applied one after the other, in the order their types
+       first appear. A node is batched if its modifiers are of different types
+       whose batches come in the order the modifiers were added, so they are
+       applied to it in that same order. The other nodes, and the external
+       nodes which update their forces themselves, call their own modifiers
+       after the batches.
+       A relative velocity damper which comes first on a batched node is
+       applied right after the beam forces, so it is left to the bond list.
+       Its kernels sum the damping of a node in a second loop over the
+       neighbors, within the same iteration over the nodes as the beams, and
+       store the force of the node once. This saves the sweep of the batch
+       over the nodes, with its barrier, and loading the bonds of the node
+       and writing its force a second time.
+       With substeps the fast forces are summed apart from the others, so the
+       order is lost anyway, and the modifiers of a batched node only need to
+       be of different types.
+    */
+    m_modifierBatches.clear();
+    m_unbatchedNodes.clear();
+    bonds->clearDamping();
+    std::vector<std::type_index> types;
+    std::vector<size_t> positions;
+    for (auto & node : nodes){
+        const bool external = std::find(m_externalNodes.begin(), m_externalNodes.end(), node)
+                              != m_externalNodes.end();
+        if (node->m_modifiers.empty() && !external)
+            continue;
+        bool batched = !external && node->store() == store;
+        const auto & modifiers = node->m_modifiers;
+        const bool fused = batched && typeid(*modifiers[0]) == typeid(RelativeVelocityDamper)
+                           && bonds->numBonds(node->index()) == node->numNeighbors();
+        positions.clear();
+        for (size_t m = fused ? 1 : 0; m < modifiers.size(); m++){
+            const auto & modifier = modifiers[m];
+            const std::type_index type(typeid(*modifier));
+            size_t k = static_cast<size_t>(std::find(types.begin(), types.end(), type) - types.begin());
+            if (k == types.size()){
+                types.push_back(type);
+                m_modifierBatches.push_back(ModifierBatch::create(*modifier));
+            }
+            const bool allowed = m_substeps > 1 ? std::find(positions.begin(), positions.end(), k) == positions.end()
+                                                : positions.empty() || k > positions.back();
+            batched = batched && allowed
+                      && m_modifierBatches[k]->accepts(node->index(), *modifier, *bonds, node->numNeighbors());
+            positions.push_back(k);
+        }
+        if (batched){
+            if (fused)
+                bonds->setDamping(node->index(), static_cast<const RelativeVelocityDamper&>(*modifiers[0]).eta());
+            for (size_t m = 0; m < positions.size(); m++)
+                m_modifierBatches[positions[m]]->add(node->index(), modifiers[m + (fused ? 1 : 0)]);
+        } else
+            m_unbatchedNodes.push_back(node);
+    }
+    m_modifierBatches.erase(std::remove_if(m_modifierBatches.begin(), m_modifierBatches.end(),
+                                           [](const std::unique_ptr<ModifierBatch> &batch){return batch->size() == 0;}),
+                            m_modifierBatches.end());
+    buildSubsteppedNodes();
+}
+
+void Lattice::buildSubsteppedNodes()
+{
+    std::vector<size_t> substepped;
+    if (m_substeps > 1)
+        for (auto & batch : m_modifierBatches)
+            if (batch->isFast())
+                substepped.insert(substepped.end(), batch->indices().begin(), batch->indices().end());
+    std::sort(substepped.begin(), substepped.end());
+    substepped.erase(std::unique(substepped.begin(), substepped.end()), substepped.end());
+
+    // A node which was not substepped before has all of its force as the
+    // slow one, which is the force it was kicked with
+    NodeStore & s = *store;
+    NodeStore::array<double> fastFx(substepped.size(), 0.0);
+    NodeStore::array<double> fastFy(substepped.size(), 0.0);
+    NodeStore::array<double> slowFx(substepped.size());
+    NodeStore::array<double> slowFy(substepped.size());
+    NodeStore::array<double> heldFx(substepped.size());
+    NodeStore::array<double> heldFy(substepped.size());
+    for (size_t k = 0; k < substepped.size(); k++){
+        const size_t i = substepped[k];
+        const auto old = std::lower_bound(m_substepped.begin(), m_substepped.end(), i);
+        if (old != m_substepped.end() && *old == i){
+            const size_t l = static_cast<size_t>(old - m_substepped.begin());
+            fastFx[k] = m_fastFx[l];
+            fastFy[k] = m_fastFy[l];
+            slowFx[k] = m_slowFx[l];
+            slowFy[k] = m_slowFy[l];
+            heldFx[k] = m_heldFx[l];
+            heldFy[k] = m_heldFy[l];
+        } else {
+            slowFx[k] = s.fx[i];
+            slowFy[k] = s.fy[i];
+            heldFx[k] = s.fx[i];
+            heldFy[k] = s.fy[i];
+        }
+    }
+    for (size_t i : m_substepped)
+        s.setFlag(i, NodeStore::SUBSTEPPED, false);
+    for (size_t i : substepped)
+        s.setFlag(i, NodeStore::SUBSTEPPED, true);
+    m_substepped.swap(substepped);
+    m_fastFx.swap(fastFx);
+    m_fastFy.swap(fastFy);
+    m_slowFx.swap(slowFx);
+    m_slowFy.swap(slowFy);
+    m_heldFx.swap(heldFx);
+    m_heldFy.swap(heldFy);
 }
 
 std::shared_ptr<LatticeInfo> Lattice::latticeInfoFromParameters(std::shared_ptr<Parameters> parameters){
@@ -55,7 +558,8 @@ std::shared_ptr<LatticeInfo> Lattice::latticeInfoFromParameters(std::shared_ptr<
     return std::make_shared<LatticeInfo>(E, nu, d, hZ);
 }
 
-std::shared_ptr<Node> Lattice::newNode(std::shared_ptr<Parameters>  parameters,
+std::shared_ptr<Node> Lattice::newNode(std::shared_ptr<NodeStore>   store,
+                                       std::shared_ptr<Parameters>  parameters,
                                        std::shared_ptr<LatticeInfo> latticeInfo,
                                        double x, double y) {
     double d  = parameters->get<double>("d");
@@ -64,44 +568,211 @@ std::shared_ptr<Node> Lattice::newNode(std::shared_ptr<Parameters>  parameters,
     double mass = density * d * d * hZ/ 4* pi;
     double momentOfInertia = d*d / 8;
     vec3 pos(x, y, 0);
-    std::shared_ptr<Node> node = std::make_shared<Node>(pos, mass, momentOfInertia, latticeInfo);
+    std::shared_ptr<Node> node = std::make_shared<Node>(store, pos, mass, momentOfInertia, latticeInfo);
     return node;
 }
 
-std::vector<DataPacket> Lattice::getDataPackets(int timestep, double time){
+std::vector<DataPacket> Lattice::getDataPackets(int timestep, double time, const DataRequest &request){
     std::vector<DataPacket> packetvec = std::vector<DataPacket>();
-
-    DataPacket position_interface_packet = DataPacket(DataPacket::dataId::INTERFACE_POSITION, timestep, time);
-    DataPacket velocity_interface_packet = DataPacket(DataPacket::dataId::INTERFACE_VELOCITY, timestep, time);
-    DataPacket position_all = DataPacket(DataPacket::dataId::ALL_POSITION, timestep, time);
-    DataPacket velocity_all = DataPacket(DataPacket::dataId::ALL_VELOCITY, timestep, time);
-    DataPacket force_all    = DataPacket(DataPacket::dataId::ALL_FORCE, timestep, time);
 //    DataPacket energy_all = DataPachet(DataPacket::dataId::NODE_TOTAL_ENERGY_ALL,timestep,time);
 
-    for (std::shared_ptr<Node> node : bottomNodes)
-    {
-        position_interface_packet.push_back(node->r().x());
-        position_interface_packet.push_back(node->r().y());
-        velocity_interface_packet.push_back(node->v().x());
-        velocity_interface_packet.push_back(node->v().y());
-    }
-
-    for (std::shared_ptr<Node> node : nodes) {
-        position_all.push_back(node->r().x());
-        position_all.push_back(node->r().y());
-        velocity_all.push_back(node->v().x());
-        velocity_all.push_back(node->v().y());
-        force_all.push_back(node->f().x());
-        force_all.push_back(node->f().y());
-    }
-    packetvec.push_back(position_interface_packet);
-    packetvec.push_back(velocity_interface_packet);
-    packetvec.push_back(position_all);
-    packetvec.push_back(velocity_all);
-    packetvec.push_back(force_all);
+    if (request.wants(DataPacket::dataId::INTERFACE_POSITION)){
+        DataPacket position_interface_packet = DataPacket(DataPacket::dataId::INTERFACE_POSITION, timestep, time,
+                                                          request.buffer(2*bottomNodes.size()));
+        for (const std::shared_ptr<Node> &node : bottomNodes){
+            position_interface_packet.push_back(node->r().x());
+            position_interface_packet.push_back(node->r().y());
+        }
+        packetvec.push_back(position_interface_packet);
+    }
+    if (request.wants(DataPacket::dataId::INTERFACE_VELOCITY)){
+        DataPacket velocity_interface_packet = DataPacket(DataPacket::dataId::INTERFACE_VELOCITY, timestep, time,
+                                                          request.buffer(2*bottomNodes.size()));
+        for (const std::shared_ptr<Node> &node : bottomNodes){
+            velocity_interface_packet.push_back(node->v().x());
+            velocity_interface_packet.push_back(node->v().y());
+        }
+        packetvec.push_back(velocity_interface_packet);
+    }
+    if (request.wants(DataPacket::dataId::ALL_POSITION)){
+        DataPacket position_all = DataPacket(DataPacket::dataId::ALL_POSITION, timestep, time, request.buffer(2*nodes.size()));
+        for (const std::shared_ptr<Node> &node : nodes){
+            position_all.push_back(node->r().x());
+            position_all.push_back(node->r().y());
+        }
+        packetvec.push_back(position_all);
+    }
+    if (request.wants(DataPacket::dataId::ALL_VELOCITY)){
+        DataPacket velocity_all = DataPacket(DataPacket::dataId::ALL_VELOCITY, timestep, time, request.buffer(2*nodes.size()));
+        for (const std::shared_ptr<Node> &node : nodes){
+            velocity_all.push_back(node->v().x());
+            velocity_all.push_back(node->v().y());
+        }
+        packetvec.push_back(velocity_all);
+    }
+    if (request.wants(DataPacket::dataId::ALL_FORCE)){
+        DataPacket force_all = DataPacket(DataPacket::dataId::ALL_FORCE, timestep, time, request.buffer(2*nodes.size()));
+        for (const std::shared_ptr<Node> &node : nodes){
+            force_all.push_back(node->f().x());
+            force_all.push_back(node->f().y());
+        }
+        packetvec.push_back(force_all);
+    }
     return packetvec;
 }
 
+double Lattice::kineticEnergy() const{
+    const NodeStore & s = *store;
+    double kinetic = 0;
+    for (size_t i = 0; i < s.size(); i++)
+        if (s.isIntegrated(i))
+            kinetic += 0.5*s.mass[i]*(s.vx[i]*s.vx[i] + s.vy[i]*s.vy[i]) + 0.5*s.inertia[i]*s.omega[i]*s.omega[i];
+    return kinetic;
+}
+
+double Lattice::potentialEnergy() const{
+    double potential = bonds->potentialEnergy(*store, *latticeInfo);
+    for (const auto & node : nodes)
+        if (node->store() == store && store->isIntegrated(node->index()))
+            for (const auto & modifier : node->m_modifiers)
+                if (modifier->hasPotential())
+                    potential += modifier->potentialEnergy();
+    return potential;
+}
+
+void Lattice::beginWork(){
+    const NodeStore & s = *store;
+    m_work = 0;
+    m_bondLength.clear();
+    bonds->bendingWork(s, *latticeInfo, m_bondLength, m_bondBending);
+    workForces(m_workFx, m_workFy, m_workMoment);
+    m_workX.assign(s.x.begin(), s.x.end());
+    m_workY.assign(s.y.begin(), s.y.end());
+    m_workPhi.assign(s.phi.begin(), s.phi.end());
+}
+
+void Lattice::addWork(){
+    /* The work of a force over a step is taken by the trapezoidal rule, from
+       the force at both ends of the step. Velocity Verlet changes the kinetic
+       energy by just that work of the forces it applies, but for a term of
+       the order of the step squared which does not add up over the steps.
+       The kinetic and potential energy less this work is then kept but for
+       the error of the integration of the forces with a potential.
+    */
+    const NodeStore & s = *store;
+    std::vector<double> fx;
+    std::vector<double> fy;
+    std::vector<double> moment;
+    workForces(fx, fy, moment);
+    double work = bonds->bendingWork(s, *latticeInfo, m_bondLength, m_bondBending);
+    for (size_t i = 0; i < s.size(); i++){
+        work += 0.5*(m_workFx[i] + fx[i])*(s.x[i] - m_workX[i])
+              + 0.5*(m_workFy[i] + fy[i])*(s.y[i] - m_workY[i])
+              + 0.5*(m_workMoment[i] + moment[i])*(s.phi[i] - m_workPhi[i]);
+    }
+    m_work += work;
+    m_workFx.swap(fx);
+    m_workFy.swap(fy);
+    m_workMoment.swap(moment);
+    m_workX.assign(s.x.begin(), s.x.end());
+    m_workY.assign(s.y.begin(), s.y.end());
+    m_workPhi.assign(s.phi.begin(), s.phi.end());
+}
+
+void Lattice::workForces(std::vector<double> &fx, std::vector<double> &fy, std::vector<double> &moment) const{
+    /* On a node the lattice integrates, the force modifiers without a
+       potential, such as the dampers and the pushers, do work. A node it
+       does not integrate, as one held by a driver beam, or one whose beam
+       forces are not applied, moves the beams while their force on it is
+       not applied, so it does work on the lattice against that force.
+    */
+    const NodeStore & s = *store;
+    fx.assign(s.size(), 0);
+    fy.assign(s.size(), 0);
+    moment.assign(s.size(), 0);
+    for (const auto & node : nodes){
+        const size_t i = node->index();
+        if (node->store() != store || !s.isIntegrated(i))
+            continue;
+        for (const auto & modifier : node->m_modifiers){
+            if (modifier->hasPotential())
+                continue;
+            const vec3 force = modifier->getForceModification();
+            fx[i]     += force.components[0];
+            fy[i]     += force.components[1];
+            moment[i] += modifier->getMomentModification();
+        }
+    }
+    for (size_t i = 0; i < s.size(); i++){
+        if (s.isIntegrated(i) && !s.isSetForce(i))
+            continue;
+        double beamFx, beamFy, beamMoment;
+        bonds->beamForce(s, *latticeInfo, i, beamFx, beamFy, beamMoment);
+        fx[i]     -= beamFx;
+        fy[i]     -= beamFy;
+        moment[i] -= beamMoment;
+    }
+}
+
+BinaryLattice Lattice::binaryRepresentation(int nx, int ny, double d) const{
+    BinaryLattice lattice;
+    lattice.nx = nx;
+    lattice.ny = ny;
+    lattice.d  = d;
+
+    // The nodes are written in the order of the list nodes, which the store
+    // may not follow when it is reordered, and then the nodes of the store
+    // which are no longer in the list, such as the top nodes taken by a
+    // driver beam, in the order of the store. External nodes live in other
+    // stores and are left out
+    const size_t numNodes = store->size();
+    const size_t unplaced = numNodes;
+    std::vector<size_t> position(numNodes, unplaced);
+    std::vector<size_t> storeIndex;
+    storeIndex.reserve(numNodes);
+    for (auto & node : nodes){
+        if (node->store() == store){
+            position[node->index()] = storeIndex.size();
+            storeIndex.push_back(node->index());
+        }
+    }
+    for (size_t i = 0; i < numNodes; i++){
+        if (position[i] == unplaced){
+            position[i] = storeIndex.size();
+            storeIndex.push_back(i);
+        }
+    }
+    lattice.x.resize(numNodes);
+    lattice.y.resize(numNodes);
+    for (size_t k = 0; k < numNodes; k++){
+        lattice.x[k] = store->x[storeIndex[k]];
+        lattice.y[k] = store->y[storeIndex[k]];
+    }
+    lattice.type.assign(numNodes, 0);
+
+    auto markNodes = [&](const std::vector<std::shared_ptr<Node>> &list, BinaryLattice::NodeType type){
+        for (auto & node : list)
+            if (node->store() == store)
+                lattice.type[position[node->index()]] |= type;
+    };
+    markNodes(topNodes,    BinaryLattice::TOP);
+    markNodes(bottomNodes, BinaryLattice::BOTTOM);
+    markNodes(leftNodes,   BinaryLattice::LEFT);
+    markNodes(normalNodes, BinaryLattice::NORMAL);
+
+    if (bonds->numBonds() > 0){
+        lattice.bondOffsets.assign(numNodes+1, 0);
+        lattice.bondNeighbors.reserve(bonds->numBonds());
+        for (size_t k = 0; k < numNodes; k++){
+            const size_t i = storeIndex[k];
+            for (size_t b = bonds->offsets[i]; b < bonds->offsets[i+1]; b++)
+                lattice.bondNeighbors.push_back(static_cast<uint32_t>(position[bonds->neighbor[b]]));
+            lattice.bondOffsets[k+1] = lattice.bondNeighbors.size();
+        }
+    }
+    return lattice;
+}
+
 std::string Lattice::xyzRepresentation(){
     std::stringstream xyz;
     // Header and empty comment
@@ -3,11 +3,16 @@
 #include <vector>
 
 #include "Node/node.h"
+#include "NodeStore/nodestore.h"
+#include "BondList/bondlist.h"
+#include "ForceModifier/ModifierBatch/modifierbatch.h"
+#include "InputManagement/BinaryLattice/binarylattice.h"
 
 class Node;
 class LatticeInfo;
 class Parameters;
 class DataPacket;
+class DataRequest;
 
 class Lattice : virtual public std::enable_shared_from_this<Lattice>
 {
@@ -16,16 +21,47 @@ public:
     ~Lattice();
     double  t() {return m_t;}
     std::string xyzRepresentation();
+    // The nodes of the store with their types and bonds. Must be called after
+    // the bond list is built
+    BinaryLattice binaryRepresentation(int nx, int ny, double d) const;
 
+    // Advances the lattice by dt. The velocities are left half a step behind
+    // the positions until synchronize() is called or the next step begins
     virtual void step(double dt);
+    // Completes the last step, so that positions and velocities belong to the
+    // same time. Must be called before the velocities are read
+    void synchronize();
+    // As step and synchronize, but run by the threads of an enclosing
+    // parallel region, which must all make the call. They return at a barrier
+    void parallelStep(double dt);
+    void parallelSynchronize();
+    // The kinetic energy of the nodes the lattice integrates, and the
+    // elastic energy of the beams with the potential of the force modifiers
+    // of those nodes. The velocities must be synchronized. Serial, for
+    // checking the energy now and then
+    double kineticEnergy() const;
+    double potentialEnergy() const;
+    // The work done on the lattice by the forces without a potential since
+    // beginWork, which the kinetic and potential energy together follow.
+    // addWork must be called after every step, before the velocities are
+    // synchronized. Serial
+    void   beginWork();
+    void   addWork();
+    double work() const {return m_work;}
     virtual void populate(std::shared_ptr<Parameters> parameters) = 0;
     virtual void populate(std::shared_ptr<Parameters>, int nx, int ny) = 0;
     virtual void populateCantilever(std::shared_ptr<Parameters>){};
     virtual void populateWithUnitCell(std::shared_ptr<Parameters>){};
     static std::shared_ptr<LatticeInfo> latticeInfoFromParameters(std::shared_ptr<Parameters> parameters);
-    static std::shared_ptr<Node> newNode(std::shared_ptr<Parameters>, std::shared_ptr<LatticeInfo>,
-                                         double x, double y);
-    virtual std::vector<DataPacket> getDataPackets(int timestep, double time);
+    static std::shared_ptr<Node> newNode(std::shared_ptr<NodeStore>, std::shared_ptr<Parameters>,
+                                         std::shared_ptr<LatticeInfo>, double x, double y);
+    virtual std::vector<DataPacket> getDataPackets(int timestep, double time, const DataRequest &request);
+    // Adds a node whose state lives outside of the store and which integrates itself
+    void addExternalNode(std::shared_ptr<Node> node);
+    // Makes the next step sort the force modifiers into batches anew. Called
+    // when modifiers are added to or removed from a node, and must be called
+    // after nodes are taken out of the list nodes
+    void invalidateModifiers() {m_modifiersChanged = true;}
 
     std::vector<std::shared_ptr<Node>> bottomNodes;
     std::vector<std::shared_ptr<Node>> topNodes;
@@ -33,7 +69,61 @@ public:
     std::vector<std::shared_ptr<Node>> normalNodes;
     std::vector<std::shared_ptr<Node>> nodes;
     std::shared_ptr<LatticeInfo>       latticeInfo;
+    std::shared_ptr<NodeStore>         store;
+    std::shared_ptr<BondList>          bonds;
 protected:
+    // Connects every pair of nodes closer than 1.01*d using a cell list
+    void connectNodes(double d);
+    // Connects the nodes as given by a bond list in CSR format, where the
+    // neighbors are indices into nodes. Used to skip the neighbor search
+    void connectNodes(const std::vector<uint64_t> &offsets, const std::vector<uint32_t> &neighbors);
+    // Packs the neighbor information of the nodes into the bond list and
+    // selects the force kernel and the substeps of the interface forces.
+    // Must be called once all of the nodes are connected
+    void buildBondList(std::shared_ptr<Parameters> parameters);
+    // Rearranges the store in the order given by the nodeOrdering parameter.
+    // The list nodes, and with it the output, keeps the original order
+    void reorderNodes(std::shared_ptr<Parameters> parameters);
+    // Sorts the force modifiers of the nodes into one batch per type, see
+    // modifierbatch.h. The nodes that can not be batched are kept apart
+    void buildModifierBatches();
+    // Finds the nodes with fast modifiers, which are substepped, and keeps
+    // the split of the forces of those that were substepped before
+    void buildSubsteppedNodes();
+    // parallelStep with the interface forces applied in substeps
+    void parallelMultiRateStep(double dt);
+    // The forces without a potential on the nodes of the store, see addWork
+    void workForces(std::vector<double> &fx, std::vector<double> &fy, std::vector<double> &moment) const;
     double m_t = 0; // Simulation time
+    double m_dt = 0; // Length of the last step
+    bool   m_synchronized = true;
+    std::vector<std::shared_ptr<Node>> m_externalNodes;
+    std::vector<std::unique_ptr<ModifierBatch>> m_modifierBatches;
+    std::vector<std::shared_ptr<Node>> m_unbatchedNodes; // Call their own modifiers
+    bool   m_modifiersChanged = true;
+    int    m_substeps = 1; // Substeps of the fast modifiers per step
+    double m_subDt = 0;    // Length of the last substep
+    // The substepped nodes, in the order of the store, with their fast
+    // forces and the rest of their forces from the end of the last step,
+    // and the rest of their forces held through its substeps
+    std::vector<size_t>      m_substepped;
+    NodeStore::array<double> m_fastFx;
+    NodeStore::array<double> m_fastFy;
+    NodeStore::array<double> m_slowFx;
+    NodeStore::array<double> m_slowFy;
+    NodeStore::array<double> m_heldFx;
+    NodeStore::array<double> m_heldFy;
+    // The work since beginWork, with the position of every node of the
+    // store at the last step and the force without a potential on it, and
+    // the length and bending factor of every bond, see BondList::bendingWork
+    double m_work = 0;
+    std::vector<double> m_workX;
+    std::vector<double> m_workY;
+    std::vector<double> m_workPhi;
+    std::vector<double> m_workFx;
+    std::vector<double> m_workFy;
+    std::vector<double> m_workMoment;
+    std::vector<double> m_bondLength;
+    std::vector<double> m_bondBending;
 };
 
@@ -17,105 +17,43 @@ std::unique_ptr<T> make_unique( Args&& ...args )
 {
     return std::unique_ptr<T>( new T( std::forward<Args>(args)... ) );
 }
-Node::Node(vec3 r, double mass, double momentOfInertia, std::shared_ptr<LatticeInfo> latticeInfo):
-    m_r(r),
-    m_v(vec3()),
-    m_f(vec3()),
-    m_phi(0),
-    m_omega(0),
-    m_mass(mass),
-    m_moment(0),
-    m_momentOfInertia(momentOfInertia),
-    m_isSetForce(false)
+Node::Node(std::shared_ptr<NodeStore> store, vec3 r, double mass, double momentOfInertia,
+           std::shared_ptr<LatticeInfo> latticeInfo):
+    m_store(store)
 {
+    m_index = m_store->add(r, mass, momentOfInertia);
     m_latticeInfo = latticeInfo;
-    m_momentOfInertia *=m_mass;
 }
 
 void Node::updateForcesAndMoments(){
-    // Reset all forces
-    m_f = 0;
-    m_moment = 0;
-
-    if (!m_isSetForce){
-        for (auto & neighbor : neighborInfo){
-            vec3 rDiff = neighbor->node()->r() - r();
-            double d0 = neighbor->d0();
-            double dij = rDiff.length();
-
-            double phiToNeighbor    = atan2(rDiff.y(), rDiff.x());
-            double neighborPhi      = neighbor->node()->phi();
-            double phiCorrection    = neighbor->phiOffset()-phiToNeighbor;
-            if(phiCorrection > pi)
-            {
-                phiCorrection -= 2*pi;
-            }
-
-            double phi_ij           = phi()+phiCorrection;
-            double phi_ji           = neighborPhi+phiCorrection;
-
-            if (phi_ij >pi/2)
-            {
-                // std::cout << "phi_ij " << phi_ij << std::endl;
-            }
-
-            if (phi_ji > pi/2)
-            {
-                // std::cout <<"phi_ji "<< phi_ji << std::endl;
-            }
-
-            if (phi_ij + phi_ji > pi)
-            {
-                // std::cout << phi_ij+phi_ji << std::endl;
-                // exit(1);
-            }
-
-            double fn               = m_latticeInfo->kappa_n()*(dij-d0);
-            double fs               = -m_latticeInfo->kappa_s()*0.5*(phi_ij + phi_ji);
-            double m                = -m_latticeInfo->kappa_s()*dij*(m_latticeInfo->Phi()/12.0*(phi_ij-phi_ji)+0.5*(2.0/3.0*phi_ij+1.0/3.0*phi_ji));
-
-            m_moment += m;
-            m_f += rDiff/dij*fn +vec3(-rDiff.y(), rDiff.x(),0)*fs/dij;
-        }
-    }
+    // The beam forces are computed for the whole lattice by the BondList,
+    // so only the modifiers are added here
+    vec3   force  = f();
+    double moment = this->moment();
     for (auto & modifier : m_modifiers)
     {
-        m_f      += modifier->getForceModification();
-        m_moment += modifier->getMomentModification();
+        force  += modifier->getForceModification();
+        moment += modifier->getMomentModification();
     }
+    setForce(force);
+    m_store->moment[m_index] = moment;
 }
 
 
 void Node::step(double dt)
 {
-    m_omega = m_omega + (m_moment/m_momentOfInertia)*dt;
-    m_phi   = m_phi + m_omega*dt;
-    m_v     = m_v + (m_f/m_mass)*dt;
-    m_r     = m_r + m_v*dt;
-}
-
-void Node::vvstep(double dt)
-{
-    m_omega += (m_moment/m_momentOfInertia)*0.5*dt;
-    m_phi   += m_omega*dt;
-    m_v     += (m_f/m_mass)*0.5*dt;
-    m_r     += m_v*dt;
+    m_store->step(m_index, dt);
 }
 
 void Node::vvstep1(double dt)
 {
-    m_omega += (m_moment/m_momentOfInertia)*0.5*dt;
-    m_phi   += m_omega*dt;
-    m_v     += (m_f/m_mass)*0.5*dt;
-    m_r     += m_v*dt;
+    m_store->kick(m_index, dt);
+    m_store->drift(m_index, dt);
 }
 
 void Node::vvstep2(double dt)
 {
-    m_omega += (m_moment/m_momentOfInertia)*0.5*dt;
-    m_phi   += m_omega*dt;
-    m_v     += (m_f/m_mass)*0.5*dt;
-    m_r     += m_v*dt;
+    m_store->kick(m_index, dt);
 }
 
 bool Node::connectToNode(std::shared_ptr<Node> other)
@@ -147,16 +85,17 @@ double Node::distanceTo(std::shared_ptr<Node> other)
 
 void Node::setPhi(double phi)
 {
-    m_phi = phi;
+    m_store->phi[m_index] = phi;
 }
 
 void Node::pertubatePosition(vec3 r)
 {
-    m_r += r;
+    m_store->x[m_index] += r[0];
+    m_store->y[m_index] += r[1];
 }
 
 void Node::pertubateRotation(double phi){
-    m_phi += phi;
+    m_store->phi[m_index] += phi;
 }
 
 double Node::t()
@@ -169,22 +108,33 @@ void Node::addModifier(std::shared_ptr<ForceModifier> modifier)
     modifier->setNode(shared_from_this());
     modifier->initialize();
     m_modifiers.push_back(std::move(modifier));
+    if (m_lattice)
+        m_lattice->invalidateModifiers();
 }
 
 void Node::clearModifiers()
 {
     m_modifiers.clear();
+    if (m_lattice)
+        m_lattice->invalidateModifiers();
 }
 
 void Node::isSetForce(bool isSetForce)
 {
-    m_isSetForce = isSetForce;
+    m_store->setFlag(m_index, NodeStore::SET_FORCE, isSetForce);
 }
 
 void Node::forcePosition(const vec3 &r){
-    m_r = r;
+    m_store->x[m_index] = r.components[0];
+    m_store->y[m_index] = r.components[1];
 }
 
 void Node::forceVelocity(const vec3& v) {
-    m_v = v;
+    m_store->vx[m_index] = v.components[0];
+    m_store->vy[m_index] = v.components[1];
+}
+
+void Node::setForce(const vec3& f) {
+    m_store->fx[m_index] = f.components[0];
+    m_store->fy[m_index] = f.components[1];
 }
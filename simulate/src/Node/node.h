@@ -2,6 +2,7 @@
 #include "NodeInfo/nodeinfo.h"
 #include "Vec3/vec3.h"
 #include "ForceModifier/forcemodifier.h"
+#include "NodeStore/nodestore.h"
 
 #include <memory>
 #include <vector>
@@ -14,13 +15,15 @@ class DriverBeam;
 class Node : public std::enable_shared_from_this<Node>
 {
 public:
-    Node(vec3 r, double mass, double momentOfInertia, std::shared_ptr<LatticeInfo> latticeInfo);
+    Node(std::shared_ptr<NodeStore> store, vec3 r, double mass, double momentOfInertia,
+         std::shared_ptr<LatticeInfo> latticeInfo);
 
     virtual void    updateForcesAndMoments();
     virtual void    step(double dt);
+    // The halves of a velocity Verlet step. vvstep1 kicks and drifts before
+    // the forces are updated, vvstep2 kicks with the new forces
     virtual void    vvstep1(double dt);
     virtual void    vvstep2(double dt);
-    virtual void    vvstep(double dt);
     bool    connectToNode(std::shared_ptr<Node> other);
     bool    connectToNode(std::shared_ptr<Node> other, double distance);
     double  distanceTo(Node & other);
@@ -30,15 +33,17 @@ public:
     void    pertubateRotation(double phi);
 
 
-    vec3    &r()              {return m_r;}
-    vec3    &v()              {return m_v;}
-    vec3    &f()              {return m_f;}
+    vec3    r()               {return vec3(m_store->x[m_index], m_store->y[m_index], 0);}
+    vec3    v()               {return vec3(m_store->vx[m_index], m_store->vy[m_index], 0);}
+    vec3    f()               {return vec3(m_store->fx[m_index], m_store->fy[m_index], 0);}
     double  t();
-    double  phi()             {return m_phi;}
-    double  omega()           {return m_omega;}
-    double  moment()          {return m_moment;}
-    double  mass()            {return m_mass;}
-    double  momentOfInertia() {return m_momentOfInertia;}
+    double  phi()             {return m_store->phi[m_index];}
+    double  omega()           {return m_store->omega[m_index];}
+    double  moment()          {return m_store->moment[m_index];}
+    double  mass()            {return m_store->mass[m_index];}
+    double  momentOfInertia() {return m_store->inertia[m_index];}
+    size_t  index()     const {return m_index;}
+    const std::shared_ptr<NodeStore> & store() const {return m_store;}
     size_t  numNeighbors()    {return neighborInfo.size();}
     const   std::vector<std::unique_ptr<NodeInfo>> & getNeighborInfo() const {return neighborInfo;}
     void    addModifier(std::shared_ptr<ForceModifier> modifier);
@@ -47,20 +52,17 @@ public:
     void    setLattice(const std::shared_ptr<Lattice>& lattice) {m_lattice = lattice;}
     void    forcePosition(const vec3 &r);
     void    forceVelocity(const vec3 &v);
-    void    setMass(double newMass){ m_mass = newMass;}
-    void    setMoment(double newMoment) {m_moment = newMoment;}
+    void    setForce(const vec3 &f);
+    void    setMass(double newMass){ m_store->mass[m_index] = newMass;}
+    void    setMoment(double newMoment) {m_store->moment[m_index] = newMoment;}
+    void    setMomentOfInertia(double newInertia) {m_store->inertia[m_index] = newInertia;}
     friend DriverBeam;
+    friend Lattice; // Moves the nodes within the store when reordering
 
 protected:
-    vec3   m_r;
-    vec3   m_v;
-    vec3   m_f;
-    double m_phi;
-    double m_omega;
-    double m_mass;
-    double m_moment;
-    double m_momentOfInertia;
-    bool   m_isSetForce;
+    // The state of the node lives in the store, at m_index
+    std::shared_ptr<NodeStore>                  m_store;
+    size_t                                      m_index;
     std::shared_ptr<LatticeInfo>                m_latticeInfo;
     std::shared_ptr<Lattice>                    m_lattice;
 
@@ -10,7 +10,7 @@ public:
     NodeInfo(std::shared_ptr<Node> node, double d0, double phiOffset);
     double d0(){return m_d0;}
     double phiOffset(){return m_phiOffset;}
-    std::shared_ptr<Node> node(){return m_node;}
+    const std::shared_ptr<Node> & node(){return m_node;}
 private:
     std::shared_ptr<Node> m_node;
     double m_phiOffset;
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include "nodeordering.h"
+
+namespace {
+// Spreads the lower 32 bits of v to the even bits of the result
+uint64_t spreadBits(uint64_t v)
+{
+    v &= 0xffffffffULL;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+    v = (v | (v << 8))  & 0x00ff00ff00ff00ffULL;
+    v = (v | (v << 4))  & 0x0f0f0f0f0f0f0f0fULL;
+    v = (v | (v << 2))  & 0x3333333333333333ULL;
+    v = (v | (v << 1))  & 0x5555555555555555ULL;
+    return v;
+}
+
+uint64_t mortonKey(uint32_t cx, uint32_t cy)
+{
+    return spreadBits(cx) | (spreadBits(cy) << 1);
+}
+
+// The distance along the Hilbert curve filling a side x side grid, side a
+// power of two, of the cell (cx, cy)
+uint64_t hilbertKey(uint32_t cx, uint32_t cy, uint32_t side)
+{
+    uint64_t key = 0;
+    for (uint32_t s = side/2; s > 0; s /= 2){
+        const uint32_t rx = (cx & s) > 0;
+        const uint32_t ry = (cy & s) > 0;
+        key += static_cast<uint64_t>(s)*s*((3*rx) ^ ry);
+        // Rotate the quadrant so the curve continues in it
+        if (ry == 0){
+            if (rx == 1){
+                cx = side-1 - cx;
+                cy = side-1 - cy;
+            }
+            std::swap(cx, cy);
+        }
+    }
+    return key;
+}
+}
+
+NodeOrdering::Kind NodeOrdering::kind(const std::string &name)
+{
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "none")
+        return Kind::NONE;
+    else if (lower == "morton")
+        return Kind::MORTON;
+    else if (lower == "hilbert")
+        return Kind::HILBERT;
+    else if (lower == "rcm")
+        return Kind::RCM;
+    else
+        throw std::runtime_error("nodeOrdering is not recognized");
+}
+
+std::vector<size_t> NodeOrdering::curveOrder(Kind kind, const double *x, const double *y, size_t n, double d)
+{
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++)
+        order[i] = i;
+    if (n == 0)
+        return order;
+    if (!(d > 0))
+        throw std::runtime_error("The cell size of the node ordering must be positive");
+
+    const double xMin = *std::min_element(x, x+n);
+    const double yMin = *std::min_element(y, y+n);
+    const double xMax = *std::max_element(x, x+n);
+    const double yMax = *std::max_element(y, y+n);
+    // Cells of side d hold about one node each
+    const double extent = std::max(xMax-xMin, yMax-yMin)/d + 1;
+    uint32_t side = 1;
+    while (side < extent && side < (1u << 31))
+        side *= 2;
+
+    std::vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; i++){
+        const uint32_t cx = std::min(static_cast<uint32_t>((x[i]-xMin)/d), side-1);
+        const uint32_t cy = std::min(static_cast<uint32_t>((y[i]-yMin)/d), side-1);
+        keys[i] = kind == Kind::MORTON ? mortonKey(cx, cy) : hilbertKey(cx, cy, side);
+    }
+    // Nodes in the same cell keep their relative order
+    std::stable_sort(order.begin(), order.end(),
+                     [&keys](size_t a, size_t b){return keys[a] < keys[b];});
+    return order;
+}
+
+std::vector<size_t> NodeOrdering::rcmOrder(const size_t *offsets, const size_t *neighbors, size_t n)
+{
+    /* Cuthill-McKee numbers the nodes breadth first, visiting the neighbors
+       of a node by increasing degree. Every connected component is started
+       from its unvisited node of lowest degree, which on a lattice is a
+       corner, and the final order is reversed.
+    */
+    auto degree = [offsets](size_t i){return offsets[i+1] - offsets[i];};
+    std::vector<size_t> byDegree(n);
+    for (size_t i = 0; i < n; i++)
+        byDegree[i] = i;
+    std::stable_sort(byDegree.begin(), byDegree.end(),
+                     [&degree](size_t a, size_t b){return degree(a) < degree(b);});
+
+    std::vector<size_t> order;
+    order.reserve(n);
+    std::vector<bool> visited(n, false);
+    std::vector<size_t> adjacent;
+    for (size_t start : byDegree){
+        if (visited[start])
+            continue;
+        visited[start] = true;
+        order.push_back(start);
+        for (size_t head = order.size()-1; head < order.size(); head++){
+            const size_t i = order[head];
+            adjacent.clear();
+            for (size_t b = offsets[i]; b < offsets[i+1]; b++)
+                if (neighbors[b] < n && !visited[neighbors[b]])
+                    adjacent.push_back(neighbors[b]);
+            std::stable_sort(adjacent.begin(), adjacent.end(),
+                             [&degree](size_t a, size_t b){return degree(a) < degree(b);});
+            for (size_t j : adjacent){
+                if (!visited[j]){
+                    visited[j] = true;
+                    order.push_back(j);
+                }
+            }
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
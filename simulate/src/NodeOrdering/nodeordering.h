@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Orders the nodes of a lattice so that nodes close in space, or bonded to
+// each other, are close in memory. The bond loop then finds the neighbors of
+// a node on the same or nearby cache lines.
+//
+//   NONE     The order of the xyz file or of the population loop
+//   MORTON   Along the Z curve through a grid of cells with side d
+//   HILBERT  Along the Hilbert curve through the same grid, which unlike the
+//            Z curve never jumps between distant cells
+//   RCM      Reverse Cuthill-McKee on the bond graph, which minimizes the
+//            bandwidth, the largest index distance of a bond
+class NodeOrdering
+{
+public:
+    enum class Kind {
+        NONE,
+        MORTON,
+        HILBERT,
+        RCM
+    };
+
+    // Parses the name of an ordering, as given by the nodeOrdering parameter
+    static Kind kind(const std::string &name);
+
+    // The new order of the nodes, as the old index of the node at each new
+    // index. The nodes are at (x[i], y[i]) with cell size d, and the bonds of
+    // node i are neighbors[offsets[i]] to neighbors[offsets[i+1]-1]
+    template <typename Positions, typename Indices>
+    static std::vector<size_t> order(Kind kind, const Positions &x, const Positions &y, double d,
+                                     const Indices &offsets, const Indices &neighbors);
+
+private:
+    static std::vector<size_t> curveOrder(Kind kind, const double *x, const double *y, size_t n, double d);
+    static std::vector<size_t> rcmOrder(const size_t *offsets, const size_t *neighbors, size_t n);
+};
+
+template <typename Positions, typename Indices>
+std::vector<size_t> NodeOrdering::order(Kind kind, const Positions &x, const Positions &y, double d,
+                                        const Indices &offsets, const Indices &neighbors)
+{
+    const size_t n = x.size();
+    switch (kind) {
+    case Kind::MORTON:
+    case Kind::HILBERT:
+        return curveOrder(kind, x.data(), y.data(), n, d);
+    case Kind::RCM:
+        return rcmOrder(offsets.data(), neighbors.data(), n);
+    case Kind::NONE:
+    default:{
+        std::vector<size_t> identity(n);
+        for (size_t i = 0; i < n; i++)
+            identity[i] = i;
+        return identity;
+    }
+    }
+}
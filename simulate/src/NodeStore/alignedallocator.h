@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+// Minimal allocator handing out memory aligned to a cache line, so that the
+// arrays of the NodeStore start on a cache line and can be loaded with aligned
+// vector instructions.
+// Elements constructed without a value are left uninitialized, as for new T,
+// so that resizing an array does not touch its pages. See placement.h.
+template <typename T, std::size_t Alignment = 64>
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+    template <typename U> struct rebind {typedef AlignedAllocator<U, Alignment> other;};
+
+    AlignedAllocator() {}
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(std::size_t n){
+        void* p = nullptr;
+        if (posix_memalign(&p, Alignment, n*sizeof(T)) != 0)
+            throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, std::size_t){
+        free(p);
+    }
+    template <typename U>
+    void construct(U* p){
+        ::new(static_cast<void*>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args){
+        ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+template <typename T, typename U, std::size_t A>
+bool operator==(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) {return true;}
+template <typename T, typename U, std::size_t A>
+bool operator!=(const AlignedAllocator<T, A>&, const AlignedAllocator<U, A>&) {return false;}
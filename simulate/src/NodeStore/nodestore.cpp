@@ -0,0 +1,95 @@
+#include <stdexcept>
+#include "nodestore.h"
+#include "placement.h"
+
+NodeStore::NodeStore()
+{
+
+}
+
+size_t NodeStore::add(const vec3 &r, double nodeMass, double momentOfInertia)
+{
+    vec3 pos = r;
+    x.push_back(pos[0]);
+    y.push_back(pos[1]);
+    vx.push_back(0);
+    vy.push_back(0);
+    fx.push_back(0);
+    fy.push_back(0);
+    phi.push_back(0);
+    omega.push_back(0);
+    moment.push_back(0);
+    mass.push_back(nodeMass);
+    inertia.push_back(momentOfInertia*nodeMass);
+    flags.push_back(0);
+    return x.size()-1;
+}
+
+void NodeStore::reserve(size_t n)
+{
+    x.reserve(n);
+    y.reserve(n);
+    vx.reserve(n);
+    vy.reserve(n);
+    fx.reserve(n);
+    fy.reserve(n);
+    phi.reserve(n);
+    omega.reserve(n);
+    moment.reserve(n);
+    mass.reserve(n);
+    inertia.reserve(n);
+    flags.reserve(n);
+}
+
+void NodeStore::setFlag(size_t i, Flag flag, bool value)
+{
+    if (value)
+        flags[i] |= flag;
+    else
+        flags[i] &= static_cast<unsigned char>(~flag);
+}
+
+namespace {
+template <typename T>
+void permuteArray(NodeStore::array<T> &a, const std::vector<size_t> &order)
+{
+    NodeStore::array<T> permuted(a.size());
+    for (size_t k = 0; k < order.size(); k++)
+        permuted[k] = a[order[k]];
+    a.swap(permuted);
+}
+}
+
+void NodeStore::permute(const std::vector<size_t> &order)
+{
+    if (order.size() != size())
+        throw std::runtime_error("The order does not match the nodes of the store");
+    permuteArray(x, order);
+    permuteArray(y, order);
+    permuteArray(vx, order);
+    permuteArray(vy, order);
+    permuteArray(fx, order);
+    permuteArray(fy, order);
+    permuteArray(phi, order);
+    permuteArray(omega, order);
+    permuteArray(moment, order);
+    permuteArray(mass, order);
+    permuteArray(inertia, order);
+    permuteArray(flags, order);
+}
+
+void NodeStore::place(Placement placement)
+{
+    placement::place(x, placement);
+    placement::place(y, placement);
+    placement::place(vx, placement);
+    placement::place(vy, placement);
+    placement::place(fx, placement);
+    placement::place(fy, placement);
+    placement::place(phi, placement);
+    placement::place(omega, placement);
+    placement::place(moment, placement);
+    placement::place(mass, placement);
+    placement::place(inertia, placement);
+    placement::place(flags, placement);
+}
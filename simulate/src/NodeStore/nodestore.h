@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "NodeStore/alignedallocator.h"
+#include "Vec3/vec3.h"
+
+enum class Placement;
+
+// Structure-of-arrays storage of the state of every node in a lattice.
+// Each quantity lives in its own contiguous, cache line aligned array, so the
+// integrator streams through memory instead of following one pointer per node.
+// A Node is only a view (store, index) into this storage.
+class NodeStore
+{
+public:
+    template <typename T>
+    using array = std::vector<T, AlignedAllocator<T>>;
+
+    enum Flag : unsigned char {
+        SET_FORCE   = 1 << 0, // Bond forces are not computed for the node
+        CONSTRAINED = 1 << 1, // Position and velocity are imposed by an owner (e.g. DriverBeam)
+        SUBSTEPPED  = 1 << 2  // Translated in the substeps of the interface forces by the lattice
+    };
+
+    NodeStore();
+    size_t add(const vec3 &r, double mass, double momentOfInertia);
+    void   reserve(size_t n);
+    size_t size() const {return x.size();}
+    bool   isIntegrated(size_t i) const {return !(flags[i] & CONSTRAINED);}
+    bool   isSetForce(size_t i)   const {return flags[i] & SET_FORCE;}
+    bool   isSubstepped(size_t i) const {return flags[i] & SUBSTEPPED;}
+    void   setFlag(size_t i, Flag flag, bool value);
+    // Rearranges the nodes such that node k is the one that was at order[k]
+    void   permute(const std::vector<size_t> &order);
+    // Moves the arrays to memory placed by placement, see placement.h.
+    // Called once the store is complete, since adding nodes reallocates
+    void   place(Placement placement);
+    // Half of a velocity Verlet step: kick advances the velocities by half a
+    // timestep with the current forces, drift the positions by a full one
+    inline void kick(size_t i, double dt);
+    inline void drift(size_t i, double dt);
+    inline void step(size_t i, double dt);
+    // As kick and drift for the rotation alone, for the substepped nodes
+    inline void kickRotation(size_t i, double dt);
+    inline void driftRotation(size_t i, double dt);
+
+    array<double>        x;
+    array<double>        y;
+    array<double>        vx;
+    array<double>        vy;
+    array<double>        fx;
+    array<double>        fy;
+    array<double>        phi;
+    array<double>        omega;
+    array<double>        moment;
+    array<double>        mass;
+    array<double>        inertia;
+    array<unsigned char> flags;
+};
+
+void NodeStore::kick(size_t i, double dt)
+{
+    omega[i] += (moment[i]/inertia[i])*0.5*dt;
+    vx[i]    += (fx[i]/mass[i])*0.5*dt;
+    vy[i]    += (fy[i]/mass[i])*0.5*dt;
+}
+
+void NodeStore::drift(size_t i, double dt)
+{
+    phi[i]   += omega[i]*dt;
+    x[i]     += vx[i]*dt;
+    y[i]     += vy[i]*dt;
+}
+
+void NodeStore::kickRotation(size_t i, double dt)
+{
+    omega[i] += (moment[i]/inertia[i])*0.5*dt;
+}
+
+void NodeStore::driftRotation(size_t i, double dt)
+{
+    phi[i]   += omega[i]*dt;
+}
+
+void NodeStore::step(size_t i, double dt)
+{
+    omega[i] = omega[i] + (moment[i]/inertia[i])*dt;
+    phi[i]   = phi[i] + omega[i]*dt;
+    vx[i]    = vx[i] + (fx[i]/mass[i])*dt;
+    vy[i]    = vy[i] + (fy[i]/mass[i])*dt;
+    x[i]     = x[i] + vx[i]*dt;
+    y[i]     = y[i] + vy[i]*dt;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include "NodeStore/nodestore.h"
+
+// Where the pages of the lattice arrays are placed in memory.
+//
+// Linux places a page on the NUMA node of the thread that first writes to it.
+// The arrays are filled serially while the lattice is built, so on a machine
+// with several sockets they all end up on the node of the master thread. The
+// arrays are therefore copied into fresh, untouched memory once the lattice is
+// complete, and the copy decides where each page lands:
+//   SERIAL      The master thread copies everything, as when building
+//   LOCAL       Each element is copied by the thread that owns it in the
+//               parallel loops of the time step, so every thread finds its
+//               nodes in its local memory
+//   INTERLEAVE  The pages are dealt out round robin over the threads, which
+//               spreads the arrays evenly over the nodes
+// Only meaningful when the threads are pinned, see ThreadConfig.
+enum class Placement {
+    SERIAL,
+    LOCAL,
+    INTERLEAVE
+};
+
+namespace placement {
+const size_t pageSize = 4096;
+
+// Copies a into memory placed by placement. The elements [rows[r], rows[r+1])
+// belong to row r, and a row is owned by the thread that runs iteration r of
+// a loop over the rows with the runtime schedule. Without rows each element
+// is a row of its own
+template <typename T>
+void place(NodeStore::array<T> &a, Placement placement, const NodeStore::array<size_t> *rows = nullptr)
+{
+    if (placement == Placement::SERIAL || a.empty())
+        return;
+    const size_t n = a.size();
+    // The allocator does not initialize the elements, so no page is touched yet
+    NodeStore::array<T> placed(n);
+    const T* source = a.data();
+    T* target = placed.data();
+
+    if (placement == Placement::INTERLEAVE){
+        const size_t perPage  = pageSize/sizeof(T) > 0 ? pageSize/sizeof(T) : 1;
+        const size_t numPages = (n + perPage - 1)/perPage;
+#pragma omp parallel for schedule(static, 1)
+        for (size_t p = 0; p < numPages; p++)
+            for (size_t i = p*perPage; i < n && i < (p+1)*perPage; i++)
+                target[i] = source[i];
+    } else if (rows){
+        const size_t numRows = rows->size() - 1;
+        const size_t* bounds = rows->data();
+#pragma omp parallel for schedule(runtime)
+        for (size_t r = 0; r < numRows; r++)
+            for (size_t i = bounds[r]; i < bounds[r+1]; i++)
+                target[i] = source[i];
+    } else {
+#pragma omp parallel for schedule(runtime)
+        for (size_t i = 0; i < n; i++)
+            target[i] = source[i];
+    }
+    a.swap(placed);
+}
+
+// As place, for arrays processed one segment [segments[s], segments[s+1]) at
+// a time, each segment split over the threads by the runtime schedule
+template <typename T>
+void placeSegments(NodeStore::array<T> &a, Placement placement, const NodeStore::array<size_t> &segments)
+{
+    if (placement != Placement::LOCAL || a.empty()){
+        place(a, placement);
+        return;
+    }
+    NodeStore::array<T> placed(a.size());
+    const T* source = a.data();
+    T* target = placed.data();
+    const size_t numSegments = segments.size() - 1;
+#pragma omp parallel
+    for (size_t s = 0; s < numSegments; s++){
+#pragma omp for schedule(runtime)
+        for (size_t i = segments[s]; i < segments[s+1]; i++)
+            target[i] = source[i];
+    }
+    a.swap(placed);
+}
+}
@@ -1,3 +1,4 @@
+#include <exception>
 #include <iostream>
 #include <memory>
 #include <chrono>
@@ -12,6 +13,7 @@
 #include "FrictionSystem/BulkWave/bulkwave.h"
 #include "FrictionSystem/BulkStretch/bulkstretch.h"
 #include "FrictionSystem/Rotate/rotate.h"
+#include "ThreadConfig/threadconfig.h"
 
 Simulation::Simulation()
     :parametersPath("input/parameters.txt")
@@ -49,6 +51,20 @@ int Simulation::setup() {
     timeForNextPhase = (*nextPhase).first;
 
     try {
+        auto region = parameters->get<std::string>("parallelRegion");
+        std::transform(region.begin(), region.end(), region.begin(), ::tolower);
+        if (region == "step")
+            persistentRegion = false;
+        else if (region == "run")
+            persistentRegion = true;
+        else
+            throw std::runtime_error("parallelRegion is not recognized");
+
+        // The threads are set up before the lattice is read, which is done in parallel
+        ThreadConfig threads(parameters);
+        threads.apply();
+        threads.report();
+
         std::cout << "Constructing system" << std::endl;
         auto systemType = parameters->get<std::string>("frictionsystem");
         std::transform(systemType.begin(), systemType.end(), systemType.begin(), ::tolower);
@@ -79,28 +95,73 @@ void Simulation::run() {
     startClock();
     system->isLockFrictionSprings(true);
     std::cout << "Starting the simulation with the model stationary and springs locked at " << timeSinceStart() << std::endl;
-    while (true){
-        system->step(step, timestep);
-        timestep++;
-        advanceProgress(timestep);
-
-        if (timestep > timeForNextPhase){
-            // Run the corresponding function
-            // using the ugliest notation in the C++-language
-            (this->*((*nextPhase).second))();
-            ++nextPhase;
-            if(nextPhase == phases.end())
+    if (persistentRegion)
+        runInParallelRegion();
+    else {
+        while (true){
+            system->step(step, timestep);
+            if (!advance())
                 break;
-
-            restartProgress();
-            timeSinceLastPhase = timeForNextPhase;
-            timeForNextPhase   = (*nextPhase).first;
         }
     }
+    system->flushOutput();
+    system->reportBondRotation();
+    system->reportEnergy();
     std::cout << "Simulation complete at " << timeSinceStart() << std::endl;
     system->postProcessing();
 }
 
+void Simulation::runInParallelRegion() {
+    /* The threads live for the whole run. They share the sweeps over the
+       lattice, while the master thread writes the output, advances the
+       timestep and runs the phases. The others wait for it at the barrier
+       that ends every step, so all of them see the same timestep and agree
+       on when to stop. Exceptions can not leave the region, so they are
+       carried out of it and rethrown.
+    */
+    bool done = false;
+    std::exception_ptr error;
+#pragma omp parallel
+    {
+        while (!done){
+            system->parallelStep(step, timestep, error);
+#pragma omp master
+            {
+                try {
+                    if (!error)
+                        done = !advance();
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                if (error)
+                    done = true;
+            }
+#pragma omp barrier
+        }
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+bool Simulation::advance(){
+    timestep++;
+    advanceProgress(timestep);
+
+    if (timestep > timeForNextPhase){
+        // Run the corresponding function
+        // using the ugliest notation in the C++-language
+        (this->*((*nextPhase).second))();
+        ++nextPhase;
+        if(nextPhase == phases.end())
+            return false;
+
+        restartProgress();
+        timeSinceLastPhase = timeForNextPhase;
+        timeForNextPhase   = (*nextPhase).first;
+    }
+    return true;
+}
+
 void Simulation::releaseSprings(){
     std::cout << "Releasing springs at " << timeSinceStart() << std::endl;
     system->isLockFrictionSprings(false);
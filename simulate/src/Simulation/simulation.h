@@ -16,6 +16,9 @@ public:
     virtual ~Simulation();
     int    setup();
     void   run();
+    // Runs one timestep of bookkeeping and the phase that is due. False
+    // when the last phase is done
+    bool   advance();
     void   advanceProgress(int i);
     double timeSinceStart();
     void   startClock(){start = std::chrono::high_resolution_clock::now();};
@@ -26,12 +29,16 @@ public:
     void   nop(){};
 
 private:
+    // The time loop inside one parallel region, see parallelRegion
+    void   runInParallelRegion();
+
     int    timestep = 0;
     double progress = 0;
     double prevProgress = 0;
     int    timeForNextPhase = 0;
     int    timeSinceLastPhase = 0;
     double step;
+    bool   persistentRegion = false;
     std::string                                     parametersPath;
     std::shared_ptr<Parameters>                     parameters;
     std::shared_ptr<FrictionSystem>                 system;
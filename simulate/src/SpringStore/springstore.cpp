@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "springstore.h"
+#include "FrictionInfo/frictioninfo.h"
+
+namespace {
+// A binary heap with the largest item by operator< at the front, as with
+// std::push_heap and std::pop_heap, but with unsigned indices
+template <typename T>
+void pushHeap(std::vector<T> &heap, const T &item)
+{
+    size_t i = heap.size();
+    heap.push_back(item);
+    while (i > 0){
+        const size_t parent = (i-1)/2;
+        if (!(heap[parent] < item))
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = item;
+}
+
+template <typename T>
+void popHeap(std::vector<T> &heap)
+{
+    const T last = heap.back();
+    heap.pop_back();
+    const size_t n = heap.size();
+    if (n == 0)
+        return;
+    size_t i = 0;
+    for (size_t child = 1; child < n; child = 2*i+1){
+        if (child+1 < n && heap[child] < heap[child+1])
+            child++;
+        if (!(last < heap[child]))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+}
+}
+
+SpringStore::SpringStore(uint64_t seed)
+    : m_random(seed)
+{
+    offsets.push_back(0);
+}
+
+size_t SpringStore::add(const FrictionInfo &info, double x, double y)
+{
+    fnAvg.push_back(info.m_fnAvg);
+    kNormal.push_back(info.m_kNormal);
+    meantime.push_back(info.m_meantime);
+    stdtime.push_back(info.m_stdtime);
+    locked.push_back(false);
+    numAttached.push_back(info.m_ns);
+    normalForce.push_back(0);
+    shearForce.push_back(0);
+    inContact.push_back(y < 0);
+    resting.push_back(false);
+    xRest.push_back(x);
+    yRest.push_back(y);
+    energyGain.push_back(0);
+    m_queues.emplace_back();
+    for (int i = 0; i < info.m_ns; i++){
+        x0.push_back(x);
+        tReattach.push_back(0);
+        k.push_back(info.m_k);
+        fs.push_back(info.m_fs);
+        fk.push_back(info.m_fk);
+        force.push_back(0);
+        connected.push_back(true);
+        detached.push_back(false);
+        isDue.push_back(false);
+        numReleases.push_back(0);
+    }
+    offsets.push_back(x0.size());
+    return size()-1;
+}
+
+vec3 SpringStore::update(size_t e, double x, double y, double t)
+{
+    /* A spring below the surface (y < 0) pulls the node back to where it is
+       attached with a force limited by the static threshold fs. Beyond it the
+       spring lets go, slides at the kinetic threshold fk, and attaches again
+       where the node is once tReattach has passed. Above the surface the
+       springs let go, and attach again as soon as they are back below it.
+       Locked springs never let go, and above the surface are moved along with
+       the node.
+    */
+    const bool contact    = y < 0;
+    const bool wasContact = inContact[e];
+    if (!contact && resting[e]){
+        xRest[e] = x;
+        yRest[e] = y;
+        return vec3(0, 0, 0);
+    }
+    if (contact != static_cast<bool>(inContact[e])){
+        inContact[e] = contact;
+#pragma omp critical(springStoreEvents)
+        m_events.push_back(ContactEvent{t, e, contact});
+    }
+    if (resting[e])
+        wake(e);
+
+    const size_t begin    = offsets[e];
+    const size_t end      = offsets[e+1];
+    const bool   isLocked = locked[e];
+    const double fn       = contact ? -y*kNormal[e] : 0.0;
+    const double average  = fnAvg[e];
+    const double stretch  = sqrt(fn/average);
+    const double slide    = sqrt(average/fn);
+
+    // The elastic energy along the surface is stretch/2 sum k (x - x0)^2.
+    // Its change as the node moves from the last update is split exactly
+    // into the part of the change of x, which is the work of the force, and
+    // the part of the change of stretch. The last, and the change as the
+    // springs are attached anew, are gained by the springs
+    double lastStretch = 0;
+    double moved       = 0;
+    double before      = 0;
+    if (m_tracksEnergy){
+        lastStretch = wasContact ? sqrt(-yRest[e]*kNormal[e]/average) : 0.0;
+        const double xLast = xRest[e];
+        for (size_t s = begin; s < end; s++){
+            moved  += k[s]*((xLast - x0[s])*(xLast - x0[s]) + (x - x0[s])*(x - x0[s]));
+            before += k[s]*(x - x0[s])*(x - x0[s]);
+        }
+    }
+
+    auto & queue = m_queues[e];
+    while (!queue.empty() && queue.front().time < t){
+        isDue[begin + queue.front().spring] = true;
+        popHeap(queue);
+    }
+
+    double attached = 0;
+    size_t numDetached = 0;
+#pragma omp simd reduction(+:attached, numDetached)
+    for (size_t s = begin; s < end; s++){
+        const bool   wasConnected = connected[s];
+        const double pull  = -(x - x0[s])*k[s]*stretch;
+        const double limit = (wasConnected ? fs[s] : fk[s])*fn/average;
+        const bool   slips = contact && std::fabs(pull) > limit && !(wasConnected && isLocked);
+        const double ft    = slips ? pull/std::fabs(pull)*fk[s]*fn/average : pull;
+        const bool   detach   = slips && wasConnected;
+        const bool   reattach = contact && !wasConnected && isDue[s];
+        const bool   release  = !contact && wasConnected && !isLocked;
+        const bool   isConnected = contact ? (wasConnected ? !detach : reattach)
+                                           : wasConnected && isLocked;
+
+        double attachedAt = slips ? x + ft/k[s]*slide : x0[s];
+        attachedAt = reattach || (!contact && isLocked) ? x : attachedAt;
+
+        x0[s]        = attachedAt;
+        connected[s] = isConnected;
+        detached[s]  = detach;
+        isDue[s]     = (isDue[s] || release) && !reattach;
+        tReattach[s] = detach ? t : tReattach[s];
+        force[s]     = contact ? ft : 0.0;
+        attached    += isConnected ? 1.0 : 0.0;
+        numDetached += detach ? 1 : 0;
+    }
+
+    double sumFn = 0;
+    double sumFt = 0;
+    if (contact){
+        for (size_t s = begin; s < end; s++){
+            sumFn += fn;
+            sumFt += force[s];
+        }
+    }
+
+    if (numDetached > 0){
+        // The springs that let go are gathered and their times drawn at once
+        static thread_local std::vector<uint32_t> spring;
+        static thread_local std::vector<uint32_t> release;
+        static thread_local std::vector<double>   delay;
+        spring.clear();
+        release.clear();
+        for (size_t s = begin; s < end; s++){
+            if (detached[s]){
+                spring.push_back(static_cast<uint32_t>(s - begin));
+                release.push_back(numReleases[s]++);
+            }
+        }
+        delay.resize(spring.size());
+        m_random.normals(static_cast<uint32_t>(e), spring.data(), release.data(), spring.size(),
+                         meantime[e], stdtime[e], delay.data());
+        for (size_t k = 0; k < spring.size(); k++){
+            tReattach[begin + spring[k]] = t + delay[k];
+            pushHeap(queue, Reattachment{t + delay[k], spring[k]});
+        }
+    }
+
+    if (m_tracksEnergy){
+        double after = 0;
+        for (size_t s = begin; s < end; s++)
+            after += k[s]*(x - x0[s])*(x - x0[s]);
+        energyGain[e] += 0.25*moved*(stretch - lastStretch) + 0.5*stretch*(after - before);
+    }
+
+    // Above the surface every spring has let go or is locked now
+    resting[e]     = !contact;
+    xRest[e]       = x;
+    yRest[e]       = y;
+    numAttached[e] = attached;
+    normalForce[e] = sumFn;
+    shearForce[e]  = sumFt;
+    return vec3(sumFt, sumFn, 0);
+}
+
+double SpringStore::potentialEnergy(size_t e, double x, double y) const
+{
+    if (!(y < 0))
+        return 0;
+    const double fn      = -y*kNormal[e];
+    const double stretch = sqrt(fn/fnAvg[e]);
+    double energy = 0;
+    for (size_t s = offsets[e]; s < offsets[e+1]; s++)
+        energy += 0.5*kNormal[e]*y*y + 0.5*k[s]*stretch*(x - x0[s])*(x - x0[s]);
+    return energy;
+}
+
+void SpringStore::setLocked(size_t e, bool isLocked)
+{
+    // A resting element lets go of its springs when they are unlocked
+    if (resting[e] && static_cast<bool>(locked[e]) != isLocked)
+        wake(e);
+    locked[e] = isLocked;
+}
+
+void SpringStore::wake(size_t e)
+{
+    if (locked[e])
+        std::fill(x0.begin() + static_cast<std::ptrdiff_t>(offsets[e]),
+                  x0.begin() + static_cast<std::ptrdiff_t>(offsets[e+1]), xRest[e]);
+    resting[e] = false;
+}
+
+std::vector<SpringStore::ContactEvent> SpringStore::takeContactEvents()
+{
+    // The elements are updated by several threads, so the events are
+    // sorted for them to come out in the same order on every run
+    std::sort(m_events.begin(), m_events.end(),
+              [](const ContactEvent &a, const ContactEvent &b){
+                  return a.time < b.time || (!(b.time < a.time) && a.element < b.element);
+              });
+    std::vector<ContactEvent> events;
+    events.swap(m_events);
+    return events;
+}
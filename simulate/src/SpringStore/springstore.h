@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "NodeStore/nodestore.h"
+#include "CounterRandom/counterrandom.h"
+
+class FrictionInfo;
+
+// Structure-of-arrays storage of the micro-springs of the friction elements.
+// Element e, the springs of one interface node, owns the springs
+// [offsets[e], offsets[e+1]), which are stored one after the other in flat
+// arrays. A SpringFriction is only a view (store, element) into this storage.
+//
+// The springs of an element are updated in one loop without branches that
+// the compiler can vectorize. The number of attached springs of the element
+// is found by a reduction over the loop, while the forces of the springs are
+// kept and summed after it in the order of the springs, so they do not
+// depend on how the loop is split into lanes.
+// Only the springs which let go draw a random reattachment time, after the
+// loop. The time of the n-th release of spring s of element e is drawn for
+// the counter (e, s, n) of a CounterRandom keyed on the seed, so it does not
+// depend on the thread which updates the element.
+//
+// The reattachments wait in a queue per element, a binary heap ordered by
+// time, so an update only looks at the reattachments that are due instead
+// of comparing the time of every detached spring.
+//
+// An element above the surface whose springs have let go, or are locked, is
+// resting: its springs do not change until it touches down again, so its
+// updates skip the springs. Only the point where locked springs are attached
+// follows the node, which is caught up on when the element wakes up. The
+// touchdowns and liftoffs of the elements are kept as contact events.
+class SpringStore
+{
+public:
+    struct ContactEvent {
+        double time;
+        size_t element;
+        bool   touchdown;          // Else the element lifted off
+    };
+
+    explicit SpringStore(uint64_t seed);
+    // Adds the ns springs of FrictionInfo for a node at (x, y), attached at
+    // x, and returns the index of the element
+    size_t add(const FrictionInfo &info, double x, double y);
+    // Updates the springs of element e for its node at (x, y) at time t, and
+    // returns the force on the node
+    vec3   update(size_t e, double x, double y, double t);
+    void   setLocked(size_t e, bool isLocked);
+    // The elastic energy of element e for its node at (x, y), as of its last
+    // update: below the surface, that of the normal springs and of every
+    // spring stretched along the surface from where it is attached
+    double potentialEnergy(size_t e, double x, double y) const;
+    // Makes the updates add up energyGain, at the cost of two more passes
+    // over the springs of an element
+    void   trackEnergy() {m_tracksEnergy = true;}
+    // The contact events since the last call, in order of time and element
+    std::vector<ContactEvent> takeContactEvents();
+    size_t size() const {return fnAvg.size();}
+    size_t numSprings() const {return x0.size();}
+
+    template <typename T>
+    using array = NodeStore::array<T>;
+
+    // Per element
+    array<size_t>  offsets;
+    array<double>  fnAvg;
+    array<double>  kNormal;
+    array<double>  meantime;
+    array<double>  stdtime;
+    array<uint8_t> locked;         // The springs move with the node and never let go
+    array<double>  numAttached;
+    array<double>  normalForce;
+    array<double>  shearForce;
+    array<uint8_t> inContact;      // Below the surface at the last update
+    array<uint8_t> resting;        // Above the surface with settled springs
+    array<double>  xRest;          // Where the node was at the last update, for locked springs
+    array<double>  yRest;
+    // The energy the springs took in other than by their force on the
+    // node, when they slide or attach again, and as their stiffness along
+    // the surface follows the depth, which their force leaves out
+    array<double>  energyGain;
+
+    // Per spring
+    array<double>  x0;             // Where the spring is attached
+    array<double>  tReattach;
+    array<double>  k;
+    array<double>  fs;
+    array<double>  fk;
+    array<double>  force;          // Along the surface, from the last update
+    array<uint8_t> connected;
+    array<uint8_t> detached;       // Let go in the last update
+    array<uint8_t> isDue;          // Detached and past its reattachment time
+    array<uint32_t> numReleases;
+
+private:
+    // Brings the springs of a resting element up to date
+    void wake(size_t e);
+
+    struct Reattachment {
+        double   time;
+        uint32_t spring;           // Within the element
+        // The heap keeps the earliest reattachment at the front
+        bool operator<(const Reattachment &other) const {return time > other.time;}
+    };
+
+    CounterRandom  m_random;
+    bool           m_tracksEnergy = false;
+    std::vector<std::vector<Reattachment>> m_queues;
+    std::vector<ContactEvent> m_events;
+};
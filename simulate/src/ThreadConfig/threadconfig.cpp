@@ -0,0 +1,235 @@
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "threadconfig.h"
+#include "InputManagement/Parameters/parameters.h"
+
+namespace {
+// The cpus of the process before any thread was pinned
+cpu_set_t processCpus;
+bool      hasProcessCpus = false;
+
+// Parses a list of cpus such as "0-3,8,10-11"
+std::vector<int> parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')){
+        if (range.empty() || range == "\n")
+            continue;
+        const size_t dash = range.find('-');
+        const int first = std::atoi(range.substr(0, dash).c_str());
+        const int last  = dash == std::string::npos ? first : std::atoi(range.substr(dash+1).c_str());
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+std::string cpuList(const std::vector<int> &cpus)
+{
+    std::stringstream out;
+    for (size_t i = 0; i < cpus.size(); i++){
+        size_t j = i;
+        while (j+1 < cpus.size() && cpus[j+1] == cpus[j]+1)
+            j++;
+        out << (i > 0 ? "," : "") << cpus[i];
+        if (j > i)
+            out << "-" << cpus[j];
+        i = j;
+    }
+    return out.str();
+}
+
+std::string scheduleName(omp_sched_t kind)
+{
+    // Without the monotonic modifier
+    switch (static_cast<int>(kind) & 0x7fffffff) {
+    case omp_sched_static:
+        return "static";
+    case omp_sched_dynamic:
+        return "dynamic";
+    case omp_sched_guided:
+        return "guided";
+    case omp_sched_auto:
+        return "auto";
+    default:
+        return "unknown";
+    }
+}
+}
+
+ThreadConfig::ThreadConfig(std::shared_ptr<Parameters> parameters)
+{
+    m_numThreads = parameters->get<int>("numThreads");
+    if (m_numThreads < 0)
+        throw std::runtime_error("numThreads must be non-negative");
+    m_chunkSize = parameters->get<int>("ompChunkSize");
+    if (m_chunkSize < 0)
+        throw std::runtime_error("ompChunkSize must be non-negative");
+
+    m_schedule = parameters->get<std::string>("ompSchedule");
+    std::transform(m_schedule.begin(), m_schedule.end(), m_schedule.begin(), ::tolower);
+    if (m_schedule != "static" && m_schedule != "dynamic"
+        && m_schedule != "guided" && m_schedule != "environment")
+        throw std::runtime_error("ompSchedule is not recognized");
+
+    auto binding = parameters->get<std::string>("threadBinding");
+    std::transform(binding.begin(), binding.end(), binding.begin(), ::tolower);
+    if (binding == "none")
+        m_binding = Binding::NONE;
+    else if (binding == "close")
+        m_binding = Binding::CLOSE;
+    else if (binding == "spread")
+        m_binding = Binding::SPREAD;
+    else
+        throw std::runtime_error("threadBinding is not recognized");
+
+    readTopology();
+}
+
+void ThreadConfig::readTopology()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        throw std::runtime_error("Could not read the cpus of the process");
+    if (!hasProcessCpus){
+        processCpus    = set;
+        hasProcessCpus = true;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &set))
+            m_allowedCpus.push_back(cpu);
+
+    // The NUMA nodes are listed by the kernel in sysfs
+    const std::string nodePath = "/sys/devices/system/node/";
+    if (DIR *dir = opendir(nodePath.c_str())){
+        while (dirent *entry = readdir(dir)){
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4
+                || name.find_first_not_of("0123456789", 4) != std::string::npos)
+                continue;
+            std::ifstream file(nodePath + name + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+            NumaNode node;
+            node.id = std::atoi(name.c_str()+4);
+            for (int cpu : parseCpuList(list))
+                if (std::binary_search(m_allowedCpus.begin(), m_allowedCpus.end(), cpu))
+                    node.cpus.push_back(cpu);
+            if (!node.cpus.empty())
+                m_numaNodes.push_back(node);
+        }
+        closedir(dir);
+    }
+    std::sort(m_numaNodes.begin(), m_numaNodes.end(),
+              [](const NumaNode &a, const NumaNode &b){return a.id < b.id;});
+
+    // Without sysfs, or with a partial one, the cpus missing from every
+    // node are put in a node of their own
+    NumaNode rest{m_numaNodes.empty() ? 0 : -1, std::vector<int>()};
+    for (int cpu : m_allowedCpus){
+        bool listed = false;
+        for (const auto & node : m_numaNodes)
+            listed = listed || std::find(node.cpus.begin(), node.cpus.end(), cpu) != node.cpus.end();
+        if (!listed)
+            rest.cpus.push_back(cpu);
+    }
+    if (!rest.cpus.empty())
+        m_numaNodes.push_back(rest);
+
+    // For the spread binding the cpus of the nodes are dealt out in turn
+    size_t numRounds = 0;
+    for (const auto & node : m_numaNodes)
+        numRounds = std::max(numRounds, node.cpus.size());
+    for (size_t round = 0; round < numRounds; round++)
+        for (const auto & node : m_numaNodes)
+            if (round < node.cpus.size())
+                m_spreadCpus.push_back(node.cpus[round]);
+}
+
+int ThreadConfig::cpuOfThread(int thread) const
+{
+    const size_t t = static_cast<size_t>(thread);
+    switch (m_binding) {
+    case Binding::NONE:
+        return -1;
+    case Binding::CLOSE:
+        return m_allowedCpus[t % m_allowedCpus.size()];
+    case Binding::SPREAD:
+        return m_spreadCpus[t % m_spreadCpus.size()];
+    default:
+        return -1;
+    }
+}
+
+void ThreadConfig::apply()
+{
+    if (m_numThreads > 0)
+        omp_set_num_threads(m_numThreads);
+    m_numThreads = omp_get_max_threads();
+
+    if (m_schedule != "environment"){
+        omp_sched_t kind = omp_sched_static;
+        if (m_schedule == "dynamic")
+            kind = omp_sched_dynamic;
+        else if (m_schedule == "guided")
+            kind = omp_sched_guided;
+        // A chunk size of 0 selects the default of the schedule
+        omp_set_schedule(kind, m_chunkSize);
+    }
+
+    // The runtime keeps its threads between parallel regions, so pinning
+    // them once holds for the whole run
+    m_threadCpus.assign(static_cast<size_t>(m_numThreads), -1);
+#pragma omp parallel
+    {
+        const int thread = omp_get_thread_num();
+        const int cpu    = cpuOfThread(thread);
+        if (cpu >= 0){
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+        m_threadCpus[static_cast<size_t>(thread)] = sched_getcpu();
+    }
+}
+
+void ThreadConfig::unpinCurrentThread()
+{
+    if (hasProcessCpus)
+        pthread_setaffinity_np(pthread_self(), sizeof(processCpus), &processCpus);
+}
+
+void ThreadConfig::report(std::ostream &out) const
+{
+    omp_sched_t kind;
+    int chunk;
+    omp_get_schedule(&kind, &chunk);
+    const char* bindings[] = {"none", "close", "spread"};
+
+    out << "Running " << m_numThreads << " threads with a " << scheduleName(kind)
+        << " schedule (chunk " << chunk << "), binding "
+        << bindings[static_cast<int>(m_binding)] << "\n"
+        << "    " << m_allowedCpus.size() << " cpus on " << m_numaNodes.size() << " NUMA nodes\n";
+    for (const auto & node : m_numaNodes){
+        if (node.id < 0)
+            out << "    not in a node: cpus " << cpuList(node.cpus) << "\n";
+        else
+            out << "    node " << node.id << ": cpus " << cpuList(node.cpus) << "\n";
+    }
+    for (size_t t = 0; t < m_threadCpus.size(); t++)
+        out << "    thread " << t << " on cpu " << m_threadCpus[t] << "\n";
+    if (static_cast<size_t>(m_numThreads) > m_allowedCpus.size())
+        out << "Warning> There are more threads than cpus" << "\n";
+    out << std::flush;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Parameters;
+
+// The number of threads, the schedule of the parallel loops over the nodes
+// and the pinning of the threads to cores, as given by the parameters
+// numThreads, ompSchedule, ompChunkSize and threadBinding.
+//
+// A numThreads of 0 leaves the count to the OpenMP runtime, which honors
+// OMP_NUM_THREADS, and a schedule of "environment" takes it from
+// OMP_SCHEDULE. The threads are pinned by the binding:
+//   none    The threads are left to the operating system
+//   close   Thread t runs on the t-th core the process may use
+//   spread  The threads are dealt out round robin over the NUMA nodes
+class ThreadConfig
+{
+public:
+    enum class Binding {
+        NONE,
+        CLOSE,
+        SPREAD
+    };
+
+    explicit ThreadConfig(std::shared_ptr<Parameters> parameters);
+    // Sets the thread count and schedule of the OpenMP runtime and pins the
+    // threads of its pool. Must be called before the first parallel region
+    void apply();
+    // Writes the topology of the machine and where each thread runs
+    void report(std::ostream &out = std::cout) const;
+    // Lets a thread that is not part of the OpenMP pool, but was started by
+    // a pinned thread, run on any of the cpus of the process again
+    static void unpinCurrentThread();
+
+    int     numThreads() const {return m_numThreads;}
+    Binding binding()    const {return m_binding;}
+
+private:
+    struct NumaNode {
+        int              id;        // -1 for the cpus missing from the nodes of sysfs
+        std::vector<int> cpus;
+    };
+    void readTopology();
+    // The cpu of thread t, or -1 if the threads are not pinned
+    int  cpuOfThread(int thread) const;
+
+    int                   m_numThreads = 0;
+    std::string           m_schedule;
+    int                   m_chunkSize = 0;
+    Binding               m_binding = Binding::NONE;
+    std::vector<int>      m_allowedCpus;
+    std::vector<NumaNode> m_numaNodes;
+    std::vector<int>      m_spreadCpus; // The cpus in the order of the spread binding
+    std::vector<int>      m_threadCpus; // Where each thread ended up running
+};
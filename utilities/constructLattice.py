@@ -32,7 +32,9 @@ and add it to an already existing geometry.
 """
 
 import os
+import struct
 import argparse
+from array import array
 import inspect
 from itertools import product
 from math import sin, cos, pi, floor,ceil
@@ -42,6 +44,15 @@ TOP_NODE_CHAR = 'T'
 NORMAL_NODE_CHAR = 'N'
 LEFT_NODE_CHAR = 'L'
 
+# Node type flags and header of the binary lattice format (.xyzb),
+# see simulate/src/InputManagement/BinaryLattice/binarylattice.h
+TOP_NODE_FLAG = 1
+BOTTOM_NODE_FLAG = 2
+LEFT_NODE_FLAG = 4
+NORMAL_NODE_FLAG = 8
+BINARY_EXTENSION = '.xyzb'
+BINARY_VERSION = 1
+
 
 class Node:
     def __init__(self, x=None, y=None):
@@ -65,6 +76,19 @@ class Node:
         self.char = char
         return "{char} {x} {y}".format(**self.__dict__)
 
+    def flags(self):
+        """ The node type as flags of the binary lattice format """
+        flags = 0
+        if self.isTop:
+            flags |= TOP_NODE_FLAG
+        if self.isBottom:
+            flags |= BOTTOM_NODE_FLAG
+        if self.isLeft:
+            flags |= LEFT_NODE_FLAG
+        if not (self.isBottom or self.isTop or self.isLeft):
+            flags |= NORMAL_NODE_FLAG
+        return flags
+
 
 class Lattice:
     def __init__(self, parametersPath, xyzPath=None):
@@ -98,18 +122,21 @@ class Lattice:
                 if len(tokens) < 2 or tokens[0][0] == '#':
                     continue
 
-                # Strings can't be evaluated.
-                # All (current) strings are something-filename
-                # This is an incredible stupid solution
-                if 'filename' in tokens[0] or 'path' in tokens[0] \
-                                    or 'frictionsystem' in tokens[0]:
-                    self.parameters[tokens[0]] = tokens[1]
-                else:
-                    # Otherwise, evaluate the expression to get
-                    # the correct int or float value
-                    self.parameters[tokens[0]] = eval(tokens[1])
+                self.parameters[tokens[0]] = self.parseValue(tokens[1])
         self.checkParameters()
 
+    @staticmethod
+    def parseValue(token):
+        """ Parses the value of a parameter as an int or a float, or keeps
+            it as a string if it is neither, such as a path or a name
+        """
+        for kind in (int, float):
+            try:
+                return kind(token)
+            except ValueError:
+                pass
+        return token
+
     def checkParameters(self):
         """ Runs tests on each parameter to determine if its value is valid
 
@@ -144,6 +171,27 @@ class Lattice:
             for node in self.nodes:
                 outfile.print(node)
 
+    def writeBinary(self):
+        """ Writes the nodes in the binary lattice format
+
+            The bonds are left out and found by the simulation.
+            Use writeLatticeBinary in the simulation to get a file with bonds.
+        """
+        with open(self.xyzPath, 'wb') as outfile:
+            print("Writing binary lattice to ", self.xyzPath)
+            flags = bytes(node.flags() for node in self.nodes)
+            counts = [sum(1 for f in flags if f & flag) for flag in
+                      (TOP_NODE_FLAG, BOTTOM_NODE_FLAG,
+                       LEFT_NODE_FLAG, NORMAL_NODE_FLAG)]
+            outfile.write(struct.pack('<4sIiid6Q', b'XYZB', BINARY_VERSION,
+                                      self.parameters['nx'],
+                                      self.parameters['ny'],
+                                      self.parameters['d'],
+                                      len(self.nodes), *counts, 0))
+            outfile.write(array('d', (node.x for node in self.nodes)).tobytes())
+            outfile.write(array('d', (node.y for node in self.nodes)).tobytes())
+            outfile.write(flags)
+
     def writeInterfaceStructure(self):
         path = os.path.split(self.xyzPath)[0] + '/interfaceStructure.txt'
         with open(path, 'w') as outfile:
@@ -153,7 +201,10 @@ class Lattice:
     def makeLattice(self, geometry):
         self.geometry = geometry(self.parameters)
         self.nodes = self.geometry.makeGeometry()
-        self.writeXYZ()
+        if self.xyzPath.endswith(BINARY_EXTENSION):
+            self.writeBinary()
+        else:
+            self.writeXYZ()
         self.writeInterfaceStructure()
 
 